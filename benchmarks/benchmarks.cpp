@@ -1,6 +1,16 @@
-#include "../lpg2/tokenizer.h"
+#include "../lpg2/constant_folding.h"
+#include "../lpg2/dead_instruction_elimination.h"
+#include "../lpg2/incremental.h"
+#include "../lpg2/incremental_type_checker.h"
+#include "../lpg2/interpreter.h"
+#include "../lpg2/lazy.h"
+#include "../lpg2/parallel_tokenizer.h"
+#include "../lpg2/parallel_type_checker.h"
+#include "../lpg2/type_checker.h"
+#include <array>
 #include <benchmark/benchmark.h>
 #include <cstring>
+#include <string>
 
 static void benchmark_store_blob(benchmark::State &state)
 {
@@ -33,7 +43,367 @@ static void benchmark_tokenizer(benchmark::State &state)
     state.SetBytesProcessed(static_cast<int64_t>(i * strlen(string)));
 }
 
+enum class generated_source
+{
+    comments,
+    string_literals,
+    mixed
+};
+
+static std::string generate_source(generated_source const kind, size_t const size)
+{
+    std::string result;
+    result.reserve(size + 200);
+    while (result.size() < size)
+    {
+        switch (kind)
+        {
+        case generated_source::comments:
+            result += "// Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut "
+                      "labore et dolore magna aliqua.\n";
+            break;
+        case generated_source::string_literals:
+            result += "print(\"Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex "
+                      "ea commodo consequat.\")\n";
+            break;
+        case generated_source::mixed:
+            result += "let greeting = \"Duis aute irure dolor in reprehenderit\"\n"
+                      "    // in voluptate velit esse cillum dolore eu fugiat nulla pariatur\n"
+                      "print(greeting)\n"
+                      "\n";
+            break;
+        }
+    }
+    return result;
+}
+
+// range(0) selects the generated_source, range(1) the lpg::simd::instruction_set
+static void benchmark_tokenizer_large(benchmark::State &state)
+{
+    auto const instructions = static_cast<lpg::simd::instruction_set>(state.range(1));
+    if (!lpg::simd::is_supported(instructions))
+    {
+        state.SkipWithError("instruction set not supported by this CPU");
+        return;
+    }
+    std::string const source = generate_source(static_cast<generated_source>(state.range(0)), 8 * 1024 * 1024);
+    lpg::simd::kernels const &kernels = lpg::simd::get_kernels(instructions);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        lpg::syntax::scanner s(source, kernels);
+        for (;;)
+        {
+            auto t = s.pop();
+            if (!t.has_value())
+            {
+                break;
+            }
+            benchmark::DoNotOptimize(t);
+        }
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
+static void benchmark_tokenize_all(benchmark::State &state)
+{
+    std::string const source = generate_source(static_cast<generated_source>(state.range(0)), 8 * 1024 * 1024);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        lpg::syntax::token_buffer tokens = lpg::syntax::tokenize_all(source);
+        benchmark::DoNotOptimize(tokens);
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
+static void benchmark_tokenize_parallel(benchmark::State &state)
+{
+    std::string const source = generate_source(generated_source::mixed, 64 * 1024 * 1024);
+    size_t const chunk_count = static_cast<size_t>(state.range(0));
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        lpg::syntax::token_buffer tokens =
+            lpg::syntax::tokenize_parallel(source, chunk_count, lpg::simd::best_kernels());
+        benchmark::DoNotOptimize(tokens);
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
+// range(0) is 1 for compile_pipelined, 2 for compile into a monotonic arena and 0 for compile
+static void benchmark_compile(benchmark::State &state)
+{
+    std::string const source = generate_source(generated_source::mixed, 8 * 1024 * 1024);
+    auto const ignore_error = [](lpg::syntax::parse_error) {
+    };
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        if (state.range(0) == 2)
+        {
+            std::pmr::monotonic_buffer_resource arena;
+            lpg::syntax::sequence parsed =
+                lpg::syntax::compile(source, ignore_error, lpg::syntax::default_max_depth, &arena);
+            benchmark::DoNotOptimize(parsed);
+        }
+        else
+        {
+            lpg::syntax::sequence parsed = state.range(0) ? lpg::syntax::compile_pipelined(source, ignore_error)
+                                                          : lpg::syntax::compile(source, ignore_error);
+            benchmark::DoNotOptimize(parsed);
+        }
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
+// range(0) is 1 for preparse and 0 for compile, on a source that consists of blocks
+static void benchmark_preparse(benchmark::State &state)
+{
+    std::string const block = "let block = {\n" + generate_source(generated_source::mixed, 4 * 1024) + "}\n";
+    std::string source;
+    while (source.size() < (8 * 1024 * 1024))
+    {
+        source += block;
+    }
+    auto const ignore_error = [](lpg::syntax::parse_error) {
+    };
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        if (state.range(0))
+        {
+            lpg::syntax::lazy_source lazy = lpg::syntax::preparse(source, ignore_error);
+            benchmark::DoNotOptimize(lazy);
+        }
+        else
+        {
+            lpg::syntax::sequence parsed = lpg::syntax::compile(source, ignore_error);
+            benchmark::DoNotOptimize(parsed);
+        }
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
+// range(0) is 1 for collecting into lpg::diagnostics and 0 for a vector of semantic_error, on a source with two type
+// errors per line
+static void benchmark_check_types_errors(benchmark::State &state)
+{
+    std::string source;
+    while (source.size() < (1024 * 1024))
+    {
+        source += "print(unknown)\n";
+    }
+    lpg::discard_errors discard;
+    lpg::syntax::flat_tree const parsed = lpg::syntax::flatten(lpg::syntax::compile(source, discard));
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        if (state.range(0))
+        {
+            lpg::diagnostics collected;
+            lpg::semantics::sequence checked = lpg::semantics::check_types(parsed, collected);
+            benchmark::DoNotOptimize(checked);
+        }
+        else
+        {
+            std::vector<lpg::semantics::semantic_error> collected;
+            lpg::semantics::sequence checked =
+                lpg::semantics::check_types(parsed, [&collected](lpg::semantics::semantic_error error) {
+                    collected.emplace_back(std::move(error));
+                });
+            benchmark::DoNotOptimize(checked);
+        }
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
+// range(0) is the thread count, on a source that consists of blocks
+static void benchmark_check_types_parallel(benchmark::State &state)
+{
+    std::string block = "{\n";
+    for (size_t i = 0; i < 200; ++i)
+    {
+        block += "    let copy = greeting\n    print(copy == greeting)\n    { let inner = copy print(inner) }\n";
+        block += (i % 2) ? "}\n{\n" : "";
+    }
+    block += "}\n";
+    std::string source = "let greeting = \"Hello\"\n";
+    while (source.size() < (1024 * 1024))
+    {
+        source += block;
+    }
+    lpg::discard_errors discard;
+    lpg::syntax::flat_tree const parsed = lpg::syntax::flatten(lpg::syntax::compile(source, discard));
+    auto const ignore_error = [](lpg::semantics::semantic_error) {
+    };
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        lpg::semantics::sequence checked = lpg::semantics::check_types_parallel(
+            parsed, ignore_error, static_cast<size_t>(state.range(0)), lpg::semantics::minimum_parallel_block_size);
+        benchmark::DoNotOptimize(checked);
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
+// edits one letter at the beginning of a large source back and forth
+static void benchmark_apply_edit(benchmark::State &state)
+{
+    std::string const prefix = "let block = {\n    print(greeting)\n}\n";
+    std::array<std::string, 2> sources = {prefix + generate_source(generated_source::mixed, 8 * 1024 * 1024), ""};
+    sources[1] = sources[0];
+    size_t const edited = prefix.find("greeting");
+    sources[1][edited] = 'f';
+    auto const ignore_error = [](lpg::syntax::parse_error) {
+    };
+    lpg::syntax::parsed_source parsed = lpg::syntax::parse_source(sources[0], ignore_error);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        ++i;
+        std::string const &next = sources[i % 2];
+        parsed = lpg::syntax::apply_edit(std::move(parsed), next,
+                                         lpg::syntax::text_edit{static_cast<std::uint32_t>(edited), 1,
+                                                                std::string_view(next).substr(edited, 1)},
+                                         ignore_error);
+        benchmark::DoNotOptimize(parsed);
+    }
+}
+
+// Edits the string that the first of many declarations is initialized with back and forth. range(0) is 1 for
+// check_again and 0 for check_types of the whole tree after every edit.
+static void benchmark_check_again(benchmark::State &state)
+{
+    std::string const prefix = "let first = { \"a\" }\n";
+    std::array<std::string, 2> sources = {prefix, ""};
+    for (size_t i = 0; sources[0].size() < (1024 * 1024); ++i)
+    {
+        // identifiers consist of letters only
+        std::string name = "x";
+        for (size_t rest = i; rest > 0; rest /= 26)
+        {
+            name += static_cast<char>('a' + (rest % 26));
+        }
+        sources[0] += "let " + name + " = first\nprint(" + name + ")\n";
+    }
+    sources[1] = sources[0];
+    size_t const edited = prefix.find('a');
+    sources[1][edited] = 'b';
+    auto const ignore_syntax_error = [](lpg::syntax::parse_error) {
+    };
+    auto const ignore_semantic_error = [](lpg::semantics::semantic_error) {
+    };
+    lpg::syntax::parsed_source parsed = lpg::syntax::parse_source(sources[0], ignore_syntax_error);
+    lpg::semantics::checked_source checked = lpg::semantics::check_source(parsed.parsed, ignore_semantic_error);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        ++i;
+        std::string const &next = sources[i % 2];
+        parsed = lpg::syntax::apply_edit(std::move(parsed), next,
+                                         lpg::syntax::text_edit{static_cast<std::uint32_t>(edited), 1,
+                                                                std::string_view(next).substr(edited, 1)},
+                                         ignore_syntax_error);
+        if (state.range(0))
+        {
+            checked = lpg::semantics::check_again(std::move(checked), parsed.parsed, ignore_semantic_error);
+            benchmark::DoNotOptimize(checked);
+        }
+        else
+        {
+            lpg::semantics::sequence result = lpg::semantics::check_types(parsed.parsed, ignore_semantic_error);
+            benchmark::DoNotOptimize(result);
+        }
+    }
+}
+
+// range(0) is 1 for a monotonic arena per run and 0 for the default memory_resource, on many small programs
+static void benchmark_run(benchmark::State &state)
+{
+    std::string const source = generate_source(generated_source::string_literals, 4 * 1024);
+    auto const ignore_syntax_error = [](lpg::syntax::parse_error) {
+    };
+    auto const ignore_semantic_error = [](lpg::semantics::semantic_error) {
+    };
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        if (state.range(0))
+        {
+            std::pmr::monotonic_buffer_resource arena;
+            lpg::run_result result = lpg::run(source, ignore_syntax_error, ignore_semantic_error, &arena);
+            benchmark::DoNotOptimize(result);
+        }
+        else
+        {
+            lpg::run_result result = lpg::run(source, ignore_syntax_error, ignore_semantic_error);
+            benchmark::DoNotOptimize(result);
+        }
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
+// range(0) is 0 for evaluating the program as checked, 1 after fold_constants and 2 after eliminate_dead_instructions
+// as well
+static void benchmark_evaluate(benchmark::State &state)
+{
+    std::string const source = generate_source(generated_source::string_literals, 64 * 1024);
+    lpg::semantics::sequence const checked = lpg::semantics::check_types(
+        lpg::syntax::compile(source,
+                             [](lpg::syntax::parse_error) {
+                             }),
+        [](lpg::semantics::semantic_error) {
+        });
+    lpg::semantics::sequence program = state.range(0) ? lpg::semantics::fold_constants(checked) : checked;
+    if (state.range(0) == 2)
+    {
+        lpg::semantics::eliminate_dead_instructions(program);
+    }
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        lpg::run_result result = lpg::evaluate(program);
+        benchmark::DoNotOptimize(result);
+        ++i;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(i * source.size()));
+}
+
 BENCHMARK(benchmark_store_blob)->Unit(benchmark::kMillisecond);
 BENCHMARK(benchmark_tokenizer);
+BENCHMARK(benchmark_tokenizer_large)
+    ->ArgsProduct({{static_cast<int64_t>(generated_source::comments),
+                    static_cast<int64_t>(generated_source::string_literals),
+                    static_cast<int64_t>(generated_source::mixed)},
+                   {static_cast<int64_t>(lpg::simd::instruction_set::scalar),
+                    static_cast<int64_t>(lpg::simd::instruction_set::sse2),
+                    static_cast<int64_t>(lpg::simd::instruction_set::avx2)}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_tokenize_all)
+    ->DenseRange(static_cast<int64_t>(generated_source::comments), static_cast<int64_t>(generated_source::mixed))
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(benchmark_tokenize_parallel)->RangeMultiplier(2)->Range(1, 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(benchmark_compile)->DenseRange(0, 2)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(benchmark_preparse)->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_check_types_errors)->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_check_types_parallel)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(benchmark_apply_edit)->Unit(benchmark::kMicrosecond);
+BENCHMARK(benchmark_check_again)->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmark_run)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(benchmark_evaluate)->DenseRange(0, 2)->Unit(benchmark::kMicrosecond);
 
 BENCHMARK_MAIN();
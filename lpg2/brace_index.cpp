@@ -0,0 +1,37 @@
+#include "brace_index.h"
+
+namespace lpg::syntax
+{
+    brace_index index_braces(token_buffer const &tokens, simd::kernels const &kernels)
+    {
+        static_assert(sizeof(token_kind) == 1);
+        char const left = static_cast<char>(token_kind::left_brace);
+        char const right = static_cast<char>(token_kind::right_brace);
+        brace_index result;
+        result.matching.resize(tokens.size(), brace_index::unmatched);
+        std::vector<std::uint32_t> open;
+        char const *const begin = reinterpret_cast<char const *>(tokens.kinds.data());
+        char const *const end = begin + tokens.size();
+        for (char const *next = kernels.find_either(begin, end, left, right); next != end;
+             next = kernels.find_either(next + 1, end, left, right))
+        {
+            std::uint32_t const index = static_cast<std::uint32_t>(next - begin);
+            if (*next == left)
+            {
+                open.emplace_back(index);
+            }
+            else if (!open.empty())
+            {
+                result.matching[index] = open.back();
+                result.matching[open.back()] = index;
+                open.pop_back();
+            }
+        }
+        return result;
+    }
+
+    brace_index index_braces(token_buffer const &tokens)
+    {
+        return index_braces(tokens, simd::best_kernels());
+    }
+} // namespace lpg::syntax
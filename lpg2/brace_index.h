@@ -0,0 +1,19 @@
+#pragma once
+#include "token_buffer.h"
+
+namespace lpg::syntax
+{
+    // Which brace token matches which, so that a block can be skipped without parsing it.
+    struct brace_index
+    {
+        static constexpr std::uint32_t unmatched = std::numeric_limits<std::uint32_t>::max();
+
+        // For a brace token i, matching[i] is the token of the other brace of the pair, or unmatched. For all other
+        // tokens it is unmatched.
+        std::vector<std::uint32_t> matching;
+    };
+
+    // Looks only at the braces, which a kernel finds among the token kinds without a branch per token.
+    [[nodiscard]] brace_index index_braces(token_buffer const &tokens, simd::kernels const &kernels);
+    [[nodiscard]] brace_index index_braces(token_buffer const &tokens);
+} // namespace lpg::syntax
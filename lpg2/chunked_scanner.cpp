@@ -0,0 +1,237 @@
+#include "chunked_scanner.h"
+#include <limits>
+
+namespace lpg::syntax
+{
+    namespace
+    {
+        // whether a token that ends exactly at the end of a chunk could be longer than what we have seen so far
+        [[nodiscard]] bool may_continue(token_kind const kind, char const *const token_end)
+        {
+            switch (kind)
+            {
+            case token_kind::identifier:
+            case token_kind::keyword_true:
+            case token_kind::keyword_false:
+            case token_kind::keyword_let:
+            case token_kind::assign:
+            case token_kind::slash:
+                return true;
+            case token_kind::comment:
+                return (token_end[-1] != '\n');
+            case token_kind::left_parenthesis:
+            case token_kind::right_parenthesis:
+            case token_kind::left_brace:
+            case token_kind::right_brace:
+            case token_kind::equals:
+            case token_kind::comma:
+            case token_kind::string_literal:
+                return false;
+            }
+            LPG_UNREACHABLE();
+        }
+    } // namespace
+
+    chunked_scanner::chunked_scanner(chunk_reader read, size_t const chunk_capacity)
+        : read(std::move(read))
+        , chunk(chunk_capacity)
+        , kernels(&simd::best_kernels())
+    {
+        assert(chunk_capacity > 0);
+    }
+
+    std::optional<token> chunked_scanner::pop()
+    {
+        auto result = peek();
+        peeked = std::nullopt;
+        return result;
+    }
+
+    std::optional<token> chunked_scanner::peek()
+    {
+        if (peeked)
+        {
+            return peeked;
+        }
+
+        for (;;)
+        {
+            char const *const begin = chunk.data();
+            next = static_cast<size_t>(kernels->skip_whitespace(begin + next, begin + chunk_size) - begin);
+            if (next != chunk_size)
+            {
+                break;
+            }
+            if (!read_chunk())
+            {
+                next_location = source_location{chunk_offset};
+                return std::nullopt;
+            }
+        }
+
+        char const *const token_begin = chunk.data() + next;
+        char const *const chunk_end = chunk.data() + chunk_size;
+        next_location = source_location{static_cast<std::uint32_t>(chunk_offset + next)};
+        raw_token const scanned = scan_token(token_begin, chunk_end, *kernels);
+        switch (scanned.status)
+        {
+        case scan_status::token:
+            if ((scanned.end == chunk_end) && may_continue(scanned.kind, scanned.end))
+            {
+                return spill_token(token_begin, scanned);
+            }
+            break;
+        case scan_status::invalid_character:
+            peeked = std::nullopt;
+            return peeked;
+        case scan_status::unterminated_string_literal:
+            // the closing quote may be in one of the next chunks
+            return spill_token(token_begin, scanned);
+        case scan_status::invalid_utf8:
+            if ((scanned.kind == token_kind::comment) && (kernels->find_new_line(scanned.end, chunk_end) == chunk_end))
+            {
+                // the chunk may end in the middle of a sequence, so check again when the comment is complete
+                return spill_token(token_begin, raw_token{scan_status::token, token_kind::comment, chunk_end});
+            }
+            has_failed = true;
+            next_location = source_location{static_cast<std::uint32_t>(chunk_offset + (scanned.end - chunk.data()))};
+            peeked = std::nullopt;
+            return peeked;
+        }
+
+        std::string_view const text(token_begin, static_cast<size_t>(scanned.end - token_begin));
+        symbol_id const symbol = (scanned.kind == token_kind::identifier) ? symbols.intern(text) : symbol_id{};
+        peeked = make_token(scanned.kind, text, symbol, next_location);
+        next += text.size();
+        next_location = source_location{static_cast<std::uint32_t>(chunk_offset + next)};
+        return peeked;
+    }
+
+    bool chunked_scanner::read_chunk()
+    {
+        assert((std::numeric_limits<std::uint32_t>::max() - chunk_offset) >= chunk_size);
+        chunk_offset += static_cast<std::uint32_t>(chunk_size);
+        next = 0;
+        chunk_size = is_end_of_input ? 0 : read(chunk);
+        assert(chunk_size <= chunk.size());
+        is_end_of_input = (chunk_size == 0);
+        return !is_end_of_input;
+    }
+
+    std::optional<token> chunked_scanner::spill_token(char const *const token_begin, raw_token const scanned)
+    {
+        source_location const location = next_location;
+        spill.assign(token_begin, static_cast<size_t>(chunk.data() + chunk_size - token_begin));
+        // an unterminated string literal is reported with token_kind::string_literal
+        token_kind pending = scanned.kind;
+        for (;;)
+        {
+            if (!read_chunk())
+            {
+                if (scanned.status == scan_status::unterminated_string_literal)
+                {
+                    has_failed = true;
+                    next_location = location;
+                    peeked = std::nullopt;
+                    return peeked;
+                }
+                break;
+            }
+
+            char const *const begin = chunk.data();
+            char const *const end = begin + chunk_size;
+            // one past the last byte of the chunk that belongs to the token
+            char const *token_end = begin;
+            bool is_complete = true;
+            auto const continue_until = [&token_end, &is_complete, end](char const *const terminator) {
+                is_complete = (terminator != end);
+                token_end = is_complete ? (terminator + 1) : end;
+            };
+            switch (pending)
+            {
+            case token_kind::identifier:
+            case token_kind::keyword_true:
+            case token_kind::keyword_false:
+            case token_kind::keyword_let:
+                while ((token_end != end) && is_identifier_letter(*token_end))
+                {
+                    ++token_end;
+                }
+                is_complete = (token_end != end);
+                break;
+            case token_kind::assign:
+                if (*begin == '=')
+                {
+                    pending = token_kind::equals;
+                    ++token_end;
+                }
+                break;
+            case token_kind::slash:
+                if (*begin == '/')
+                {
+                    pending = token_kind::comment;
+                    continue_until(kernels->find_new_line(begin + 1, end));
+                }
+                break;
+            case token_kind::comment:
+                continue_until(kernels->find_new_line(begin, end));
+                break;
+            case token_kind::string_literal:
+                continue_until(kernels->find_quote(begin, end));
+                break;
+            case token_kind::left_parenthesis:
+            case token_kind::right_parenthesis:
+            case token_kind::left_brace:
+            case token_kind::right_brace:
+            case token_kind::equals:
+            case token_kind::comma:
+                LPG_UNREACHABLE();
+            }
+            spill.append(begin, static_cast<size_t>(token_end - begin));
+            next = static_cast<size_t>(token_end - begin);
+            if (is_complete)
+            {
+                break;
+            }
+        }
+
+        switch (pending)
+        {
+        case token_kind::identifier:
+        case token_kind::keyword_true:
+        case token_kind::keyword_false:
+        case token_kind::keyword_let:
+            pending = find_keyword(spill);
+            break;
+        case token_kind::left_parenthesis:
+        case token_kind::right_parenthesis:
+        case token_kind::left_brace:
+        case token_kind::right_brace:
+        case token_kind::slash:
+        case token_kind::assign:
+        case token_kind::equals:
+        case token_kind::comma:
+        case token_kind::string_literal:
+        case token_kind::comment:
+            break;
+        }
+        if ((pending == token_kind::string_literal) || (pending == token_kind::comment))
+        {
+            // skip the opening quote or the slashes
+            char const *const content = spill.data() + ((pending == token_kind::string_literal) ? 1 : 2);
+            char const *const spill_end = spill.data() + spill.size();
+            char const *const invalid = kernels->find_invalid_utf8(content, spill_end);
+            if (invalid != spill_end)
+            {
+                has_failed = true;
+                next_location = source_location{location.offset + static_cast<std::uint32_t>(invalid - spill.data())};
+                peeked = std::nullopt;
+                return peeked;
+            }
+        }
+        symbol_id const symbol = (pending == token_kind::identifier) ? symbols.intern(spill) : symbol_id{};
+        peeked = make_token(pending, spill, symbol, location);
+        next_location = source_location{static_cast<std::uint32_t>(chunk_offset + next)};
+        return peeked;
+    }
+} // namespace lpg::syntax
@@ -0,0 +1,49 @@
+#pragma once
+#include "tokenizer.h"
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace lpg::syntax
+{
+    // Writes the next part of the input into the buffer and returns the number of bytes written. Returns 0 at the end
+    // of the input.
+    using chunk_reader = std::function<size_t(std::span<char> buffer)>;
+
+    // A scanner for input that arrives in chunks, so that it never has to be held in memory all at once. A token that
+    // crosses the boundary between two chunks is copied into a spill buffer. Memory use is bounded by the chunk size
+    // plus the size of the longest token.
+    //
+    // The contents of a token point into the current chunk or into the spill buffer, so they stay valid only until the
+    // next call of peek after the token was popped.
+    struct chunked_scanner
+    {
+        chunk_reader read;
+        std::vector<char> chunk;
+        // number of valid bytes in chunk
+        size_t chunk_size = 0;
+        // position of the next unscanned byte in chunk
+        size_t next = 0;
+        // offset of chunk[0] in the whole input
+        std::uint32_t chunk_offset = 0;
+        bool is_end_of_input = false;
+        std::string spill;
+        simd::kernels const *kernels;
+        symbol_table symbols;
+        source_location next_location;
+
+        std::optional<token> peeked;
+        bool has_failed = false;
+
+        chunked_scanner(chunk_reader read, size_t chunk_capacity);
+
+        [[nodiscard]] std::optional<token> pop();
+        [[nodiscard]] std::optional<token> peek();
+
+    private:
+        // returns false at the end of the input
+        bool read_chunk();
+        [[nodiscard]] std::optional<token> spill_token(char const *token_begin, raw_token scanned);
+    };
+} // namespace lpg::syntax
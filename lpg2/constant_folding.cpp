@@ -0,0 +1,140 @@
+#include "constant_folding.h"
+
+namespace lpg::semantics
+{
+    namespace
+    {
+        // The strings point into the input of fold_constants.
+        using known_value = std::variant<std::monostate, std::pmr::string const *, builtin_functions>;
+
+        struct constant_folder
+        {
+            std::pmr::memory_resource *resource;
+            std::pmr::vector<known_value> known;
+            // the locals for the combined prints come behind those of the input
+            size_t next_local;
+            // what the prints that have been folded since the last flush print
+            std::pmr::string pending_output;
+            bool has_reached_poison = false;
+
+            constant_folder(sequence const &input, std::pmr::memory_resource *const resource)
+                : resource(resource)
+                , known(count_locals(input), resource)
+                , next_local(known.size())
+                , pending_output(resource)
+            {
+            }
+
+            [[nodiscard]] std::pmr::string const *known_string(local_id const local) const
+            {
+                std::pmr::string const *const *const found = std::get_if<std::pmr::string const *>(&known[local.value]);
+                return found ? *found : nullptr;
+            }
+
+            // Prints the pending output in front of an instruction whose effect is not known.
+            void flush(sequence &output)
+            {
+                if (pending_output.empty())
+                {
+                    return;
+                }
+                local_id const text{next_local++};
+                local_id const function{next_local++};
+                local_id const result{next_local++};
+                output.elements.emplace_back(string_literal{text, std::move(pending_output)});
+                pending_output = std::pmr::string(resource);
+                output.elements.emplace_back(builtin{function, builtin_functions::print});
+                output.elements.emplace_back(call{result, function, std::pmr::vector<local_id>({text}, resource)});
+            }
+
+            void fold_call(call const &input, sequence &output)
+            {
+                builtin_functions const *const function = std::get_if<builtin_functions>(&known[input.callee.value]);
+                if (function)
+                {
+                    switch (*function)
+                    {
+                    case builtin_functions::print:
+                        if (input.arguments.size() == 1)
+                        {
+                            if (std::pmr::string const *const message = known_string(input.arguments[0]))
+                            {
+                                pending_output += *message;
+                                return;
+                            }
+                        }
+                        break;
+                    case builtin_functions::equals_string:
+                        if (input.arguments.size() == 2)
+                        {
+                            std::pmr::string const *const left = known_string(input.arguments[0]);
+                            std::pmr::string const *const right = known_string(input.arguments[1]);
+                            if (left && right)
+                            {
+                                output.elements.emplace_back(boolean_literal{input.result, (*left == *right)});
+                                return;
+                            }
+                        }
+                        break;
+                    }
+                }
+                flush(output);
+                output.elements.emplace_back(
+                    call{input.result, input.callee, std::pmr::vector<local_id>(input.arguments, resource)});
+            }
+
+            void fold(sequence const &input, sequence &output)
+            {
+                for (instruction const &element : input.elements)
+                {
+                    if (has_reached_poison)
+                    {
+                        return;
+                    }
+                    std::visit(overloaded{[this, &output](builtin const &builtin_) {
+                                              known[builtin_.destination.value] = builtin_.function;
+                                              output.elements.emplace_back(builtin_);
+                                          },
+                                          [this, &output](call const &call_) {
+                                              fold_call(call_, output);
+                                          },
+                                          [this, &output](string_literal const &literal) {
+                                              known[literal.destination.value] = &literal.value;
+                                              output.elements.emplace_back(string_literal{
+                                                  literal.destination, std::pmr::string(literal.value, resource)});
+                                          },
+                                          [this, &output](sequence const &nested) {
+                                              sequence folded{std::pmr::vector<instruction>(resource)};
+                                              fold(nested, folded);
+                                              if (!folded.elements.empty())
+                                              {
+                                                  output.elements.emplace_back(std::move(folded));
+                                              }
+                                          },
+                                          [&output](void_literal const &literal) {
+                                              output.elements.emplace_back(literal);
+                                          },
+                                          [this, &output](poison const &poison_) {
+                                              flush(output);
+                                              output.elements.emplace_back(poison_);
+                                              has_reached_poison = true;
+                                          },
+                                          [&output](boolean_literal const &literal) {
+                                              output.elements.emplace_back(literal);
+                                          }},
+                               element);
+                }
+            }
+        };
+    } // namespace
+
+    sequence fold_constants(sequence const &input, std::pmr::memory_resource *const resource)
+    {
+        constant_folder folder(input, resource);
+        sequence result{std::pmr::vector<instruction>(resource)};
+        result.elements.reserve(input.elements.size());
+        folder.fold(input, result);
+        folder.flush(result);
+        return result;
+    }
+} // namespace lpg::semantics
@@ -0,0 +1,13 @@
+#pragma once
+#include "type_checker.h"
+
+namespace lpg::semantics
+{
+    // Evaluates what is known before the program runs. A call of equals_string on two string_literals becomes a
+    // boolean_literal, and the prints of string_literals are combined into one print. That print happens right in
+    // front of the next instruction whose effect is not known, or at the end. Nothing behind a poison is kept, because
+    // the program stops there. A let needs no handling of its own, because the name refers to the local of its
+    // initializer. Running the result has the same outcome as running input. The result is allocated from resource.
+    [[nodiscard]] sequence fold_constants(sequence const &input,
+                                          std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+} // namespace lpg::semantics
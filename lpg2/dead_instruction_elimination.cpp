@@ -0,0 +1,126 @@
+#include "dead_instruction_elimination.h"
+
+namespace lpg::semantics
+{
+    namespace
+    {
+        struct dead_instruction_eliminator
+        {
+            // the builtin that each local holds, if it is defined by a builtin instruction
+            std::pmr::vector<std::optional<builtin_functions>> functions;
+            std::pmr::vector<bool> is_read;
+
+            dead_instruction_eliminator(size_t const local_count, std::pmr::memory_resource *const resource)
+                : functions(local_count, resource)
+                , is_read(local_count, false, resource)
+            {
+            }
+
+            // Finds the builtins and cuts everything behind the first poison. Returns whether there was a poison.
+            [[nodiscard]] bool find_builtins(sequence &program)
+            {
+                for (size_t i = 0; i < program.elements.size(); ++i)
+                {
+                    instruction &element = program.elements[i];
+                    bool const is_stopping = std::visit(overloaded{[this](builtin const &builtin_) {
+                                                                       functions[builtin_.destination.value] =
+                                                                           builtin_.function;
+                                                                       return false;
+                                                                   },
+                                                                   [this](sequence &nested) {
+                                                                       return find_builtins(nested);
+                                                                   },
+                                                                   [](poison const &) {
+                                                                       return true;
+                                                                   },
+                                                                   [](auto const &) {
+                                                                       return false;
+                                                                   }},
+                                                        element);
+                    if (is_stopping)
+                    {
+                        program.elements.erase(program.elements.begin() + static_cast<std::ptrdiff_t>(i + 1),
+                                               program.elements.end());
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Returns whether element has to stay, and marks the locals that it reads if so.
+            [[nodiscard]] bool is_needed(instruction &element)
+            {
+                return std::visit(overloaded{[this](builtin const &builtin_) -> bool {
+                                                 return is_read[builtin_.destination.value];
+                                             },
+                                             [this](call const &call_) -> bool {
+                                                 std::optional<builtin_functions> const function =
+                                                     functions[call_.callee.value];
+                                                 // the type checker lets == have too many arguments, which fails
+                                                 // when the program runs
+                                                 bool const has_effect =
+                                                     !function || (*function != builtin_functions::equals_string) ||
+                                                     (call_.arguments.size() != 2);
+                                                 if (!has_effect && !is_read[call_.result.value])
+                                                 {
+                                                     return false;
+                                                 }
+                                                 is_read[call_.callee.value] = true;
+                                                 for (local_id const argument : call_.arguments)
+                                                 {
+                                                     is_read[argument.value] = true;
+                                                 }
+                                                 return true;
+                                             },
+                                             [this](string_literal const &literal) -> bool {
+                                                 return is_read[literal.destination.value];
+                                             },
+                                             [this](sequence &nested) {
+                                                 sweep(nested);
+                                                 return !nested.elements.empty();
+                                             },
+                                             [this](void_literal const &literal) -> bool {
+                                                 return is_read[literal.destination.value];
+                                             },
+                                             [](poison const &) {
+                                                 return true;
+                                             },
+                                             [this](boolean_literal const &literal) -> bool {
+                                                 return is_read[literal.destination.value];
+                                             }},
+                                  element);
+            }
+
+            // Goes backwards, so that every read of a local has been seen when its definition is reached.
+            void sweep(sequence &program)
+            {
+                std::pmr::vector<bool> is_kept(program.elements.size(), is_read.get_allocator());
+                for (size_t i = program.elements.size(); i > 0; --i)
+                {
+                    is_kept[i - 1] = is_needed(program.elements[i - 1]);
+                }
+                size_t kept = 0;
+                for (size_t i = 0; i < program.elements.size(); ++i)
+                {
+                    if (is_kept[i])
+                    {
+                        if (kept != i)
+                        {
+                            program.elements[kept] = std::move(program.elements[i]);
+                        }
+                        ++kept;
+                    }
+                }
+                program.elements.erase(program.elements.begin() + static_cast<std::ptrdiff_t>(kept),
+                                       program.elements.end());
+            }
+        };
+    } // namespace
+
+    void eliminate_dead_instructions(sequence &program)
+    {
+        dead_instruction_eliminator eliminator(count_locals(program), program.elements.get_allocator().resource());
+        (void)eliminator.find_builtins(program);
+        eliminator.sweep(program);
+    }
+} // namespace lpg::semantics
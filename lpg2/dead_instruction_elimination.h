@@ -0,0 +1,12 @@
+#pragma once
+#include "type_checker.h"
+
+namespace lpg::semantics
+{
+    // Removes the instructions of a checked program that running it does not need: everything behind the first poison,
+    // because the program stops there, and every instruction without an effect whose result is never read, which
+    // includes calls of equals_string with two arguments. The calls of print, the calls of equals_string with another
+    // number of arguments, which fail, and the calls of locals that are not known to hold a builtin stay.
+    // Nested sequences that become empty are removed too. Running the result has the same outcome as running program.
+    void eliminate_dead_instructions(sequence &program);
+} // namespace lpg::semantics
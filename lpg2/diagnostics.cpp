@@ -0,0 +1,102 @@
+#include "diagnostics.h"
+
+namespace lpg
+{
+    std::string_view get_message(message_id const which) noexcept
+    {
+        switch (which)
+        {
+        case message_id::expected_identifier_at_end:
+            return "Expected identifier but got end of stream";
+        case message_id::expected_identifier:
+            return "Expected identifier";
+        case message_id::expected_special_character_at_end:
+            return "Expected special character but got end of stream";
+        case message_id::expected_different_special_character:
+            return "Expected a different special character";
+        case message_id::expected_something_else:
+            return "Expected something else";
+        case message_id::nesting_too_deep:
+            return "Nesting is too deep";
+        case message_id::missing_closing_brace:
+            return "Missing closing brace '}' before end of file";
+        case message_id::could_not_parse_arguments:
+            return "Could not parse arguments of the function";
+        case message_id::could_not_parse_argument:
+            return "Could not parse argument of the function";
+        case message_id::unexpected_end_of_stream:
+            return "Unexpected end of stream";
+        case message_id::closing_parenthesis_here:
+            return "Can not have a closing parenthesis here.";
+        case message_id::slash_here:
+            return "Can not have a slash here.";
+        case message_id::assignment_operator_here:
+            return "Can not have an assignment operator here.";
+        case message_id::comma_here:
+            return "Can not have a comma operator here.";
+        case message_id::invalid_initializer:
+            return "Invalid initializer value for identifier: ";
+        case message_id::missing_right_hand_side:
+            return "Binary operator requires a right-hand side argument";
+        case message_id::tokenization_failed:
+            return "Tokenization failed";
+        case message_id::not_callable:
+            return "This value is not callable";
+        case message_id::argument_type_mismatch:
+            return "Argument type mismatch";
+        case message_id::unknown_identifier:
+            return "Unknown identifier";
+        case message_id::local_already_exists:
+            return "Local variable with this name already exists";
+        case message_id::types_not_comparable:
+            return "These types are not comparable";
+        }
+        LPG_UNREACHABLE();
+    }
+
+    diagnostics::diagnostics(size_t const max_count)
+        : max_count(max_count)
+    {
+    }
+
+    void diagnostics::add(message_id const message, syntax::source_location const where,
+                          std::string_view const argument)
+    {
+        if (is_full())
+        {
+            return;
+        }
+        std::uint64_t const key = (static_cast<std::uint64_t>(where.offset) << 8) | static_cast<std::uint8_t>(message);
+        if (!seen.insert(key).second)
+        {
+            ++duplicates;
+            return;
+        }
+        entries.emplace_back(diagnostic{message, where, static_cast<std::uint32_t>(arguments.size()),
+                                        static_cast<std::uint32_t>(argument.size())});
+        arguments += argument;
+    }
+
+    std::string_view diagnostics::get_argument(diagnostic const &entry) const noexcept
+    {
+        return std::string_view(arguments).substr(entry.argument_offset, entry.argument_length);
+    }
+
+    std::string diagnostics::format(diagnostic const &entry) const
+    {
+        std::string_view const message = get_message(entry.message);
+        std::string_view const argument = get_argument(entry);
+        std::string result;
+        result.reserve(message.size() + argument.size());
+        result += message;
+        result += argument;
+        return result;
+    }
+
+    std::string diagnostics::format(diagnostic const &entry, syntax::line_index &lines) const
+    {
+        std::ostringstream result;
+        result << lines.locate(entry.where) << ": " << format(entry);
+        return result.str();
+    }
+} // namespace lpg
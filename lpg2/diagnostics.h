@@ -0,0 +1,89 @@
+#pragma once
+#include "line_index.h"
+#include "tokenizer.h"
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace lpg
+{
+    // Every message that the parser and the type checker report. The text of each is in get_message.
+    enum class message_id : std::uint8_t
+    {
+        expected_identifier_at_end,
+        expected_identifier,
+        expected_special_character_at_end,
+        expected_different_special_character,
+        expected_something_else,
+        nesting_too_deep,
+        missing_closing_brace,
+        could_not_parse_arguments,
+        could_not_parse_argument,
+        unexpected_end_of_stream,
+        closing_parenthesis_here,
+        slash_here,
+        assignment_operator_here,
+        comma_here,
+        invalid_initializer,
+        missing_right_hand_side,
+        tokenization_failed,
+        not_callable,
+        argument_type_mismatch,
+        unknown_identifier,
+        local_already_exists,
+        types_not_comparable
+    };
+
+    // The argument of a diagnostic, if any, is appended to this.
+    [[nodiscard]] std::string_view get_message(message_id which) noexcept;
+
+    // A reported problem without its text, which is only put together by diagnostics::format.
+    struct diagnostic
+    {
+        message_id message;
+        syntax::source_location where;
+        // the argument is diagnostics::arguments.substr(argument_offset, argument_length)
+        std::uint32_t argument_offset = 0;
+        std::uint32_t argument_length = 0;
+    };
+
+    inline constexpr size_t default_max_diagnostics = 100;
+
+    // An error sink for the parser and the type checker that receives message ids instead of messages. The arguments of
+    // all diagnostics share one string. A diagnostic with the same message and location as an earlier one is dropped,
+    // and once max_count diagnostics have been kept the front end stops early.
+    struct diagnostics
+    {
+        size_t max_count = default_max_diagnostics;
+        std::vector<diagnostic> entries;
+        std::string arguments;
+        // how many were dropped as duplicates
+        size_t duplicates = 0;
+
+        explicit diagnostics(size_t max_count = default_max_diagnostics);
+
+        void add(message_id message, syntax::source_location where, std::string_view argument = {});
+
+        [[nodiscard]] bool is_full() const noexcept
+        {
+            return entries.size() >= max_count;
+        }
+
+        [[nodiscard]] std::string_view get_argument(diagnostic const &entry) const noexcept;
+        [[nodiscard]] std::string format(diagnostic const &entry) const;
+        // The message behind the line and the column of the diagnostic, like "3:14: Unknown identifier".
+        [[nodiscard]] std::string format(diagnostic const &entry, syntax::line_index &lines) const;
+
+    private:
+        // message and location of every entry in one number
+        std::unordered_set<std::uint64_t> seen;
+    };
+
+    // An error sink like diagnostics, which the parser and the type checker pass message ids to and stop early for.
+    template <class ErrorSink>
+    concept collects_diagnostics =
+        requires(std::remove_cvref_t<ErrorSink> &sink, message_id message, syntax::source_location where) {
+            sink.add(message, where, std::string_view());
+            { sink.is_full() } -> std::convertible_to<bool>;
+        };
+} // namespace lpg
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+namespace lpg
+{
+    // The parser and the type checker call their error sink with every error. A sink that does not look at the
+    // messages can declare `static constexpr bool needs_messages = false;` to get errors with empty messages instead,
+    // so that no message is built for it.
+    template <class ErrorSink>
+    concept ignores_error_messages = requires { requires !std::remove_cvref_t<ErrorSink>::needs_messages; };
+
+    struct discard_errors
+    {
+        static constexpr bool needs_messages = false;
+
+        template <class Error>
+        void operator()(Error const &) const noexcept
+        {
+        }
+    };
+
+    // For when only pass or fail matters.
+    struct count_errors
+    {
+        static constexpr bool needs_messages = false;
+
+        size_t count = 0;
+
+        template <class Error>
+        void operator()(Error const &) noexcept
+        {
+            ++count;
+        }
+    };
+} // namespace lpg
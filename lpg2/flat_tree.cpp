@@ -0,0 +1,123 @@
+#include "flat_tree.h"
+#include "overloaded.h"
+
+namespace lpg::syntax
+{
+    namespace
+    {
+        struct flattener
+        {
+            flat_tree &result;
+
+            node_index add(node_kind const kind, source_location const location, node_data const data)
+            {
+                node_index const index{static_cast<std::uint32_t>(result.size())};
+                result.kinds.emplace_back(kind);
+                result.locations.emplace_back(location);
+                result.data.emplace_back(data);
+                return index;
+            }
+
+            std::uint32_t add_text(std::string_view const text)
+            {
+                std::uint32_t const index = static_cast<std::uint32_t>(result.texts.size());
+                result.texts.emplace_back(text);
+                return index;
+            }
+
+            // The slots are reserved before the children are flattened, because their own lists are appended behind.
+            std::uint32_t reserve_list(size_t const length)
+            {
+                std::uint32_t const first = static_cast<std::uint32_t>(result.children.size());
+                result.children.resize(result.children.size() + length);
+                return first;
+            }
+
+            node_index add_identifier(identifier const &value)
+            {
+                return add(node_kind::identifier, value.location,
+                           node_data{add_text(value.content), value.symbol.value});
+            }
+
+            node_index add_sequence(sequence const &value)
+            {
+                std::uint32_t const first = reserve_list(value.elements.size());
+                for (size_t i = 0; i < value.elements.size(); ++i)
+                {
+                    result.children[first + i] = add_expression(value.elements[i]);
+                }
+                return add(node_kind::sequence, value.location,
+                           node_data{first, static_cast<std::uint32_t>(value.elements.size())});
+            }
+
+            node_index add_expression(expression const &value)
+            {
+                return std::visit(
+                    overloaded{
+                        [this](string_literal_expression const &string) -> node_index {
+                            return add(node_kind::string_literal, string.location,
+                                       node_data{add_text(string.literal.inner_content), 0});
+                        },
+                        [this](identifier const &identifier_) -> node_index {
+                            return add_identifier(identifier_);
+                        },
+                        [this](call const &call_) -> node_index {
+                            std::uint32_t const first = reserve_list(1 + call_.arguments.size());
+                            node_index const callee = add_expression(*call_.callee);
+                            result.children[first] = callee;
+                            for (size_t i = 0; i < call_.arguments.size(); ++i)
+                            {
+                                result.children[first + 1 + i] = add_expression(*call_.arguments[i]);
+                            }
+                            return add(node_kind::call, result.locations[callee.value],
+                                       node_data{first, static_cast<std::uint32_t>(call_.arguments.size())});
+                        },
+                        [this](sequence const &sequence_) -> node_index {
+                            return add_sequence(sequence_);
+                        },
+                        [this](declaration const &declaration_) -> node_index {
+                            node_index const name = add_identifier(declaration_.name);
+                            node_index const initializer = add_expression(*declaration_.initializer);
+                            return add(node_kind::declaration, declaration_.name.location,
+                                       node_data{name.value, initializer.value});
+                        },
+                        [this](bool_literal_expression const &boolean) -> node_index {
+                            return add(node_kind::bool_literal, boolean.location,
+                                       node_data{boolean.literal.inner_content ? 1u : 0u, 0});
+                        },
+                        [this](binary_operator_expression const &binary_operator) -> node_index {
+                            std::uint32_t const first = reserve_list(2);
+                            node_index const left = add_expression(*binary_operator.left);
+                            result.children[first] = left;
+                            result.children[first + 1] = add_expression(*binary_operator.right);
+                            return add(node_kind::binary_operator, result.locations[left.value],
+                                       node_data{first, static_cast<std::uint32_t>(binary_operator.which)});
+                        },
+                        [this](binary_operator_literal_expression const &literal) -> node_index {
+                            return add(node_kind::binary_operator_literal, literal.location,
+                                       node_data{static_cast<std::uint32_t>(literal.which), 0});
+                        }},
+                    value.value);
+            }
+        };
+    } // namespace
+
+    flat_tree flatten(sequence const &tree, std::pmr::memory_resource *const resource)
+    {
+        flat_tree result(resource);
+        flattener{result}.add_sequence(tree);
+        return result;
+    }
+
+    flat_tree flatten(expression const &tree, std::pmr::memory_resource *const resource)
+    {
+        flat_tree result(resource);
+        (void)flattener{result}.add_expression(tree);
+        return result;
+    }
+
+    source_location get_location(flat_tree const &tree, node_index const node)
+    {
+        return tree.locations[node.value];
+    }
+} // namespace lpg::syntax
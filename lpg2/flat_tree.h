@@ -0,0 +1,91 @@
+#pragma once
+#include "parser.h"
+#include <memory_resource>
+#include <span>
+
+namespace lpg::syntax
+{
+    // One tag for each alternative of expression.
+    enum class node_kind : std::uint8_t
+    {
+        string_literal,
+        identifier,
+        call,
+        sequence,
+        declaration,
+        bool_literal,
+        binary_operator,
+        binary_operator_literal
+    };
+
+    // The position of a node in a flat_tree.
+    struct node_index
+    {
+        std::uint32_t value = 0;
+
+        std::weak_ordering operator<=>(node_index const &other) const noexcept = default;
+    };
+
+    // What a node refers to. The meaning depends on the kind:
+    //   string_literal: first is the index of the inner content in texts
+    //   identifier: first is the index of the name in texts, second is the symbol_id
+    //   call: children[first] is the callee, followed by second arguments
+    //   sequence: children[first] is the first of second elements
+    //   declaration: first is the identifier node of the name, second is the node of the initializer
+    //   bool_literal: first is 1 for true and 0 for false
+    //   binary_operator: children[first] and children[first + 1] are the operands, second is the binary_operator
+    //   binary_operator_literal: first is the binary_operator
+    struct node_data
+    {
+        std::uint32_t first = 0;
+        std::uint32_t second = 0;
+    };
+
+    // A syntax tree without a heap allocation per node. Node i is described by kinds[i], locations[i] and data[i].
+    // Children are referenced by index, and the children of a node always come before it, so the root is the last
+    // node. The texts point into the same source as the tree that was flattened.
+    struct flat_tree
+    {
+        std::pmr::vector<node_kind> kinds;
+        // what get_location returns for the node
+        std::pmr::vector<source_location> locations;
+        std::pmr::vector<node_data> data;
+        // the lists of arguments, elements and operands
+        std::pmr::vector<node_index> children;
+        std::pmr::vector<std::string_view> texts;
+
+        explicit flat_tree(std::pmr::memory_resource *const resource = std::pmr::get_default_resource())
+            : kinds(resource)
+            , locations(resource)
+            , data(resource)
+            , children(resource)
+            , texts(resource)
+        {
+        }
+
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return kinds.size();
+        }
+
+        // the top-level sequence
+        [[nodiscard]] node_index root() const noexcept
+        {
+            assert(size() > 0);
+            return node_index{static_cast<std::uint32_t>(size() - 1)};
+        }
+
+        [[nodiscard]] std::span<node_index const> list(std::uint32_t const first, std::uint32_t const length) const
+        {
+            return std::span<node_index const>(children).subspan(first, length);
+        }
+    };
+
+    // The flat_tree is allocated from resource.
+    [[nodiscard]] flat_tree flatten(sequence const &tree,
+                                    std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+    // The root of the result is the node of tree.
+    [[nodiscard]] flat_tree flatten(expression const &tree,
+                                    std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+    [[nodiscard]] source_location get_location(flat_tree const &tree, node_index node);
+} // namespace lpg::syntax
@@ -2,6 +2,52 @@
 
 namespace lpg::syntax
 {
+    namespace
+    {
+        // Whether an operand of parent has to be put in parentheses to be parsed as that operand again. inner is the
+        // operator of the operand if it is a binary expression.
+        [[nodiscard]] bool needs_parentheses(binary_operator const parent, std::optional<binary_operator> const inner,
+                                             bool const is_declaration, bool const is_right)
+        {
+            if (is_declaration)
+            {
+                // the initializer would take the rest of the expression
+                return !is_right;
+            }
+            if (!inner)
+            {
+                return false;
+            }
+            binary_operator_info const &outer_info = get_binary_operator_info(parent);
+            binary_operator_info const &inner_info = get_binary_operator_info(*inner);
+            if (inner_info.precedence != outer_info.precedence)
+            {
+                return (inner_info.precedence < outer_info.precedence);
+            }
+            return (is_right != outer_info.is_right_associative);
+        }
+
+        [[nodiscard]] bool needs_parentheses(binary_operator const parent, expression const &operand,
+                                             bool const is_right)
+        {
+            binary_operator_expression const *const binary = std::get_if<binary_operator_expression>(&operand.value);
+            return needs_parentheses(parent, binary ? std::optional<binary_operator>(binary->which) : std::nullopt,
+                                     std::holds_alternative<declaration>(operand.value), is_right);
+        }
+
+        [[nodiscard]] bool needs_parentheses(binary_operator const parent, flat_tree const &tree,
+                                             node_index const operand, bool const is_right)
+        {
+            node_kind const kind = tree.kinds[operand.value];
+            return needs_parentheses(parent,
+                                     (kind == node_kind::binary_operator)
+                                         ? std::optional<binary_operator>(
+                                               static_cast<binary_operator>(tree.data[operand.value].second))
+                                         : std::nullopt,
+                                     (kind == node_kind::declaration), is_right);
+        }
+    } // namespace
+
     void formatter::format(string_literal_expression const &value)
     {
         output << "\"" << value.literal.inner_content << "\"";
@@ -61,9 +107,15 @@ namespace lpg::syntax
 
     void formatter::format(binary_operator_expression const &value)
     {
-        format_expression(*value.left);
+        auto const format_operand = [this, &value](expression const &operand, bool const is_right) {
+            bool const is_wrapped = needs_parentheses(value.which, operand, is_right);
+            output << (is_wrapped ? "(" : "");
+            format_expression(operand);
+            output << (is_wrapped ? ")" : "");
+        };
+        format_operand(*value.left, false);
         output << " " << value.which << " ";
-        format_expression(*value.right);
+        format_operand(*value.right, true);
     }
 
     void formatter::format(binary_operator_literal_expression const &value)
@@ -80,6 +132,78 @@ namespace lpg::syntax
             value.value);
     }
 
+    void formatter::format(flat_tree const &tree, node_index const node)
+    {
+        node_data const data = tree.data[node.value];
+        switch (tree.kinds[node.value])
+        {
+        case node_kind::string_literal:
+            output << "\"" << tree.texts[data.first] << "\"";
+            return;
+        case node_kind::identifier:
+            output << tree.texts[data.first];
+            return;
+        case node_kind::call: {
+            std::span<node_index const> const arguments = tree.list(data.first + 1, data.second);
+            format(tree, tree.children[data.first]);
+            output << "(";
+            for (size_t i = 0; i < arguments.size(); ++i)
+            {
+                if (i > 0)
+                {
+                    output << ", ";
+                }
+                format(tree, arguments[i]);
+            }
+            output << ")";
+            return;
+        }
+        case node_kind::sequence:
+            if (indentation_level > 0)
+            {
+                output << "{\n";
+            }
+            ++indentation_level;
+            for (node_index const element : tree.list(data.first, data.second))
+            {
+                print_indentation(indentation_level - 1);
+                format(tree, element);
+                output << "\n";
+            }
+            --indentation_level;
+            if (indentation_level > 0)
+            {
+                print_indentation(indentation_level - 1);
+                output << "}";
+            }
+            return;
+        case node_kind::declaration:
+            output << "let " << tree.texts[tree.data[data.first].first] << " = ";
+            format(tree, node_index{data.second});
+            return;
+        case node_kind::bool_literal:
+            output << boolean_literal{data.first != 0};
+            return;
+        case node_kind::binary_operator: {
+            binary_operator const which = static_cast<binary_operator>(data.second);
+            auto const format_operand = [this, &tree, which](node_index const operand, bool const is_right) {
+                bool const is_wrapped = needs_parentheses(which, tree, operand, is_right);
+                output << (is_wrapped ? "(" : "");
+                format(tree, operand);
+                output << (is_wrapped ? ")" : "");
+            };
+            format_operand(tree.children[data.first], false);
+            output << " " << which << " ";
+            format_operand(tree.children[data.first + 1], true);
+            return;
+        }
+        case node_kind::binary_operator_literal:
+            output << static_cast<binary_operator>(data.first);
+            return;
+        }
+        LPG_UNREACHABLE();
+    }
+
     void formatter::print_indentation(size_t const level)
     {
         for (size_t i = 0; i < level; ++i)
@@ -1,5 +1,5 @@
 #pragma once
-#include "parser.h"
+#include "flat_tree.h"
 
 namespace lpg::syntax
 {
@@ -17,6 +17,8 @@ namespace lpg::syntax
         void format(binary_operator_expression const &value);
         void format(binary_operator_literal_expression const &value);
         void format_expression(expression const &value);
+        // prints the same as the overloads for the tree that was flattened
+        void format(flat_tree const &tree, node_index node);
         void print_indentation(size_t const level);
     };
 } // namespace lpg::syntax
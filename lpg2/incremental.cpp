@@ -0,0 +1,445 @@
+#include "incremental.h"
+#include "overloaded.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace lpg::syntax
+{
+    namespace
+    {
+        template <class T>
+        void splice(std::vector<T> &into, size_t const first, size_t const last, std::vector<T> const &replacement)
+        {
+            auto const where = into.begin() + static_cast<std::ptrdiff_t>(first);
+            into.insert(into.erase(where, where + static_cast<std::ptrdiff_t>(last - first)), replacement.begin(),
+                        replacement.end());
+        }
+
+        [[nodiscard]] bool is_brace(token_kind const kind) noexcept
+        {
+            return (kind == token_kind::left_brace) || (kind == token_kind::right_brace);
+        }
+
+        // Finds the left brace that is still open right before the token at index before.
+        [[nodiscard]] std::optional<size_t> find_enclosing_left_brace(token_buffer const &tokens, size_t before)
+        {
+            size_t depth = 0;
+            while (before > 0)
+            {
+                --before;
+                if (tokens.kinds[before] == token_kind::right_brace)
+                {
+                    ++depth;
+                }
+                else if (tokens.kinds[before] == token_kind::left_brace)
+                {
+                    if (depth == 0)
+                    {
+                        return before;
+                    }
+                    --depth;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Counts the parentheses and braces in [first, before) that are still open at before. The source parsed
+        // without errors, so they are balanced.
+        [[nodiscard]] size_t count_open_brackets(token_buffer const &tokens, size_t const first, size_t before)
+        {
+            size_t open = 0;
+            size_t closed = 0;
+            while (before > first)
+            {
+                --before;
+                token_kind const kind = tokens.kinds[before];
+                if ((kind == token_kind::right_parenthesis) || (kind == token_kind::right_brace))
+                {
+                    ++closed;
+                }
+                else if ((kind == token_kind::left_parenthesis) || (kind == token_kind::left_brace))
+                {
+                    if (closed == 0)
+                    {
+                        ++open;
+                    }
+                    else
+                    {
+                        --closed;
+                    }
+                }
+            }
+            return open;
+        }
+
+        [[nodiscard]] size_t find_token(token_buffer const &tokens, source_location const location)
+        {
+            return static_cast<size_t>(
+                std::lower_bound(tokens.offsets.begin(), tokens.offsets.end(), location.offset) -
+                tokens.offsets.begin());
+        }
+
+        // Returns the index of the first token of an element of a sequence. get_location skips the parentheses and
+        // the let in front, and the token in front of an element can be neither.
+        [[nodiscard]] size_t find_first_token(token_buffer const &tokens, expression const &element)
+        {
+            size_t first = find_token(tokens, get_location(element));
+            while ((first > 0) && ((tokens.kinds[first - 1] == token_kind::left_parenthesis) ||
+                                   (tokens.kinds[first - 1] == token_kind::keyword_let)))
+            {
+                --first;
+            }
+            return first;
+        }
+
+        // Counts the parentheses and braces that are still open at the left brace of the block at the end of path,
+        // which find_block returned. Every brace on the path is open, so only the tokens from the beginning of each
+        // element on the path to the next brace on the path are scanned, not everything in front of the block.
+        [[nodiscard]] size_t count_enclosing_brackets(token_buffer const &tokens, std::vector<expression *> const &path)
+        {
+            size_t open = 0;
+            size_t segment_begin = 0;
+            for (size_t i = 0; i < path.size(); ++i)
+            {
+                if ((i == 0) || std::holds_alternative<sequence>(path[i - 1]->value))
+                {
+                    segment_begin = find_first_token(tokens, *path[i]);
+                }
+                if (sequence const *const block = std::get_if<sequence>(&path[i]->value))
+                {
+                    size_t const brace = find_token(tokens, block->location);
+                    open += count_open_brackets(tokens, segment_begin, brace);
+                    if ((i + 1) < path.size())
+                    {
+                        // the brace of the block that the rest of the path is in
+                        ++open;
+                    }
+                }
+            }
+            return open;
+        }
+
+        // Finds the right brace that closes the brace which is still open right before the token at index from.
+        [[nodiscard]] std::optional<size_t> find_enclosing_right_brace(token_buffer const &tokens, size_t from)
+        {
+            size_t depth = 0;
+            for (; from < tokens.size(); ++from)
+            {
+                if (tokens.kinds[from] == token_kind::left_brace)
+                {
+                    ++depth;
+                }
+                else if (tokens.kinds[from] == token_kind::right_brace)
+                {
+                    if (depth == 0)
+                    {
+                        return from;
+                    }
+                    --depth;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Counts the frames that the parser keeps for the expressions on the path to a block apart from brackets: one
+        // for each declaration, and one for each binary operator whose right side is on the path, because the left
+        // side is complete before the operator is pushed.
+        [[nodiscard]] size_t count_unbracketed_frames(std::vector<expression *> const &path)
+        {
+            size_t frames = 0;
+            for (size_t i = 0; i < path.size(); ++i)
+            {
+                if (std::holds_alternative<declaration>(path[i]->value))
+                {
+                    ++frames;
+                }
+                else if (binary_operator_expression const *const binary =
+                             std::get_if<binary_operator_expression>(&path[i]->value);
+                         binary && ((i + 1) < path.size()) && (binary->right.get() == path[i + 1]))
+                {
+                    ++frames;
+                }
+            }
+            return frames;
+        }
+
+        // Moves a reused tree into the edited source. Locations in the reused part are either in front of the edit or
+        // behind it, so only the latter are shifted. The string views are taken from the new source again because
+        // the previous source may be gone.
+        struct relocation
+        {
+            std::string_view new_source;
+            std::uint32_t edit_offset;
+            std::uint32_t shift;
+            // the block that has already been replaced
+            sequence const *skipped;
+
+            [[nodiscard]] source_location move(source_location const location) const noexcept
+            {
+                return (location.offset < edit_offset) ? location : source_location{location.offset + shift};
+            }
+        };
+
+        // Returns whether tree contains the skipped block. Only the hashes on the path to that block are out of date,
+        // so they are computed again on the way back up.
+        bool relocate(relocation const &how, sequence &tree);
+
+        void relocate(relocation const &how, identifier &name)
+        {
+            name.location = how.move(name.location);
+            name.content = how.new_source.substr(name.location.offset, name.content.size());
+        }
+
+        bool relocate(relocation const &how, expression &tree)
+        {
+            bool const contains_skipped =
+                std::visit(overloaded{[&how](string_literal_expression &string) {
+                                          string.location = how.move(string.location);
+                                          // skip the opening quote
+                                          string.literal.inner_content = how.new_source.substr(
+                                              string.location.offset + 1, string.literal.inner_content.size());
+                                          return false;
+                                      },
+                                      [&how](identifier &name) {
+                                          relocate(how, name);
+                                          return false;
+                                      },
+                                      [&how](call &call_) {
+                                          bool result = relocate(how, *call_.callee);
+                                          for (expression_ptr &argument : call_.arguments)
+                                          {
+                                              result |= relocate(how, *argument);
+                                          }
+                                          return result;
+                                      },
+                                      [&how](sequence &block) {
+                                          return relocate(how, block);
+                                      },
+                                      [&how](declaration &declaration_) {
+                                          relocate(how, declaration_.name);
+                                          return relocate(how, *declaration_.initializer);
+                                      },
+                                      [&how](bool_literal_expression &boolean) {
+                                          boolean.location = how.move(boolean.location);
+                                          return false;
+                                      },
+                                      [&how](binary_operator_expression &binary) {
+                                          bool const left = relocate(how, *binary.left);
+                                          return relocate(how, *binary.right) || left;
+                                      },
+                                      [&how](binary_operator_literal_expression &literal) {
+                                          literal.location = how.move(literal.location);
+                                          return false;
+                                      }},
+                           tree.value);
+            if (contains_skipped)
+            {
+                tree.hash = expression::hash_node(tree.value);
+            }
+            return contains_skipped;
+        }
+
+        bool relocate(relocation const &how, sequence &tree)
+        {
+            if (&tree == how.skipped)
+            {
+                return true;
+            }
+            tree.location = how.move(tree.location);
+            bool result = false;
+            for (expression &element : tree.elements)
+            {
+                result |= relocate(how, element);
+            }
+            return result;
+        }
+
+        // Like relocate for the top-level sequence, whose location is always at the beginning of the source because it
+        // does not come from a token.
+        void relocate_source(relocation const &how, sequence &parsed)
+        {
+            for (expression &element : parsed.elements)
+            {
+                (void)relocate(how, element);
+            }
+        }
+
+        [[nodiscard]] parsed_source parse_all(std::string_view const source, token_buffer tokens,
+                                              std::function<void(parse_error)> const &on_error)
+        {
+            bool has_errors = false;
+            parser parser(token_cursor{source, std::move(tokens)}, [&has_errors, &on_error](parse_error error) {
+                has_errors = true;
+                on_error(std::move(error));
+            });
+            sequence parsed = parser.parse_sequence(false, source_location{0});
+            if (parser.tokens.has_failed)
+            {
+                parser.report(message_id::tokenization_failed, parser.tokens.next_location);
+            }
+            return parsed_source{std::move(parser.tokens.tokens), std::move(parsed), has_errors};
+        }
+    } // namespace
+
+    token_edit relex(token_buffer &tokens, std::string_view const new_source, text_edit const &edit,
+                     simd::kernels const &kernels)
+    {
+        if (new_source.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("The source is too large for 32-bit token offsets");
+        }
+        // unsigned arithmetic wraps around, so adding shift moves an offset backwards if more was removed than inserted
+        std::uint32_t const shift = static_cast<std::uint32_t>(edit.inserted.size()) - edit.removed_length;
+        std::uint32_t const edit_end = edit.offset + static_cast<std::uint32_t>(edit.inserted.size());
+        assert(edit_end <= new_source.size());
+
+        // A token that ends right where the edit begins can still grow, like an identifier followed by a letter.
+        size_t first = 0;
+        {
+            size_t count = tokens.size();
+            while (count > 0)
+            {
+                size_t const half = count / 2;
+                size_t const middle = first + half;
+                if ((tokens.offsets[middle] + tokens.lengths[middle]) < edit.offset)
+                {
+                    first = middle + 1;
+                    count -= half + 1;
+                }
+                else
+                {
+                    count = half;
+                }
+            }
+        }
+
+        // the tokens that replace [first, behind) of the previous ones, and where tokenization ends now
+        token_buffer relexed;
+        char const *const begin = new_source.data();
+        char const *const end = begin + new_source.size();
+        char const *next = (first == 0) ? begin : (begin + tokens.offsets[first - 1] + tokens.lengths[first - 1]);
+        // the first previous token that does not begin in front of next
+        size_t behind = first;
+        for (;;)
+        {
+            if ((next != end) && is_whitespace(*next))
+            {
+                next = kernels.skip_whitespace(next, end);
+            }
+            std::uint32_t const offset = static_cast<std::uint32_t>(next - begin);
+            if (offset >= edit_end)
+            {
+                std::uint32_t const previous_offset = offset - shift;
+                while ((behind < tokens.size()) && (tokens.offsets[behind] < previous_offset))
+                {
+                    ++behind;
+                }
+                // invalid UTF-8 stops tokenization inside of a token, so it is not a place where lexing could begin
+                bool const is_synchronized =
+                    (behind < tokens.size())
+                        ? (tokens.offsets[behind] == previous_offset)
+                        : (!tokens.has_invalid_utf8 && (tokens.end_offset == previous_offset));
+                if (is_synchronized)
+                {
+                    relexed.end_offset = tokens.end_offset + shift;
+                    relexed.has_failed = tokens.has_failed;
+                    relexed.has_invalid_utf8 = tokens.has_invalid_utf8;
+                    break;
+                }
+            }
+            if ((next == end) || !lex_token(new_source, next, kernels, relexed, tokens.symbols))
+            {
+                behind = tokens.size();
+                relexed.end_offset = static_cast<std::uint32_t>(next - begin);
+                break;
+            }
+        }
+
+        token_edit result{first,
+                          std::vector<token_kind>(tokens.kinds.begin() + static_cast<std::ptrdiff_t>(first),
+                                                  tokens.kinds.begin() + static_cast<std::ptrdiff_t>(behind)),
+                          relexed.size()};
+        splice(tokens.kinds, first, behind, relexed.kinds);
+        splice(tokens.offsets, first, behind, relexed.offsets);
+        splice(tokens.lengths, first, behind, relexed.lengths);
+        splice(tokens.symbol_ids, first, behind, relexed.symbol_ids);
+        for (size_t i = first + relexed.size(); i < tokens.size(); ++i)
+        {
+            tokens.offsets[i] += shift;
+        }
+        tokens.end_offset = relexed.end_offset;
+        tokens.has_failed = relexed.has_failed;
+        tokens.has_invalid_utf8 = relexed.has_invalid_utf8;
+        return result;
+    }
+
+    token_edit relex(token_buffer &tokens, std::string_view const new_source, text_edit const &edit)
+    {
+        return relex(tokens, new_source, edit, simd::best_kernels());
+    }
+
+    parsed_source parse_source(std::string_view const source, std::function<void(parse_error)> on_error)
+    {
+        return parse_all(source, tokenize_all(source), on_error);
+    }
+
+    parsed_source apply_edit(parsed_source previous, std::string_view const new_source, text_edit const &edit,
+                             std::function<void(parse_error)> on_error)
+    {
+        token_buffer tokens = std::move(previous.tokens);
+        token_edit const changed = relex(tokens, new_source, edit);
+        size_t const changed_end = changed.first + changed.inserted;
+        bool const changes_braces =
+            std::any_of(changed.removed.begin(), changed.removed.end(), is_brace) ||
+            std::any_of(tokens.kinds.begin() + static_cast<std::ptrdiff_t>(changed.first),
+                        tokens.kinds.begin() + static_cast<std::ptrdiff_t>(changed_end), is_brace);
+        if (previous.has_errors || tokens.has_failed || changes_braces)
+        {
+            return parse_all(new_source, std::move(tokens), on_error);
+        }
+
+        std::uint32_t const shift = static_cast<std::uint32_t>(edit.inserted.size()) - edit.removed_length;
+        if (changed.removed.empty() && (changed.inserted == 0))
+        {
+            // only whitespace changed
+            relocate_source(relocation{new_source, edit.offset, shift, nullptr}, previous.parsed);
+            return parsed_source{std::move(tokens), std::move(previous.parsed), false};
+        }
+
+        std::optional<size_t> const left_brace = find_enclosing_left_brace(tokens, changed.first);
+        std::optional<size_t> const right_brace = find_enclosing_right_brace(tokens, changed_end);
+        if (!left_brace || !right_brace)
+        {
+            return parse_all(new_source, std::move(tokens), on_error);
+        }
+        source_location const block_location{tokens.offsets[*left_brace]};
+        std::vector<expression *> path;
+        sequence *const block = find_block(previous.parsed, block_location, path);
+        if (!block)
+        {
+            return parse_all(new_source, std::move(tokens), on_error);
+        }
+        // the frames that are on the parse stack when compile reaches the block: the outermost sequence, one for each
+        // open parenthesis or brace and those on the way to the block
+        size_t const enclosing_depth = 1 + count_enclosing_brackets(tokens, path) + count_unbracketed_frames(path);
+
+        std::vector<parse_error> errors;
+        parser block_parser(token_cursor{new_source, std::move(tokens)}, [&errors](parse_error error) {
+            errors.emplace_back(std::move(error));
+        });
+        block_parser.max_depth = (enclosing_depth < default_max_depth) ? (default_max_depth - enclosing_depth) : 0;
+        block_parser.tokens.next_token = *left_brace + 1;
+        sequence reparsed = block_parser.parse_sequence(true, block_location);
+        bool const is_same_block = (block_parser.tokens.next_token == (*right_brace + 1));
+        tokens = std::move(block_parser.tokens.tokens);
+        if (!errors.empty() || !is_same_block)
+        {
+            return parse_all(new_source, std::move(tokens), on_error);
+        }
+
+        *block = std::move(reparsed);
+        relocate_source(relocation{new_source, edit.offset, shift, block}, previous.parsed);
+        return parsed_source{std::move(tokens), std::move(previous.parsed), false};
+    }
+} // namespace lpg::syntax
@@ -0,0 +1,54 @@
+#pragma once
+#include "parser.h"
+
+namespace lpg::syntax
+{
+    // Replaces removed_length bytes at offset with inserted.
+    struct text_edit
+    {
+        std::uint32_t offset = 0;
+        std::uint32_t removed_length = 0;
+        std::string_view inserted;
+    };
+
+    // Which tokens relex replaced: [first, first + removed.size()) of the previous buffer became
+    // [first, first + inserted) of the new one.
+    struct token_edit
+    {
+        size_t first = 0;
+        std::vector<token_kind> removed;
+        size_t inserted = 0;
+    };
+
+    // Updates the tokens of a source to the tokens of new_source, which is that source with edit applied. Lexing starts
+    // at the first token the edit can touch and stops as soon as a token begins where a previous token began behind
+    // the edit, because from there on the text and therefore the tokens are the same. The tokens behind that point
+    // are only shifted. New identifiers are interned into the existing symbol table, so symbol ids may differ from
+    // those of tokenize_all. Throws std::length_error like tokenize_all.
+    [[nodiscard]] token_edit relex(token_buffer &tokens, std::string_view new_source, text_edit const &edit,
+                                   simd::kernels const &kernels);
+    [[nodiscard]] token_edit relex(token_buffer &tokens, std::string_view new_source, text_edit const &edit);
+
+    // What has to be kept between edits to parse a source incrementally.
+    struct parsed_source
+    {
+        token_buffer tokens;
+        sequence parsed;
+        bool has_errors = false;
+    };
+
+    // Parses like compile, but keeps the tokens for apply_edit.
+    [[nodiscard]] parsed_source parse_source(std::string_view source, std::function<void(parse_error)> on_error);
+
+    // Parses new_source, which is the previous source with edit applied. The result is the same as that of compile
+    // except for the symbol ids. Only the innermost brace block around the changed tokens is parsed again, and the
+    // rest of the tree is reused with its locations shifted. That saves the parsing, not the passes over the source:
+    // the token offsets behind the edit and the locations in the reused tree are still shifted one by one, and the
+    // enclosing braces are found by scanning the tokens, so an edit still costs time linear in the size of the source.
+    // The whole source is parsed again when the previous parse
+    // had errors, because the parser recovers differently depending on where it starts, when the edit adds or removes
+    // braces, when the block can not be parsed cleanly or when the edit is not inside of any block.
+    // The previous source may already be gone because only new_source is read.
+    [[nodiscard]] parsed_source apply_edit(parsed_source previous, std::string_view new_source, text_edit const &edit,
+                                           std::function<void(parse_error)> on_error);
+} // namespace lpg::syntax
@@ -0,0 +1,310 @@
+#include "incremental_type_checker.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace lpg::semantics
+{
+    namespace
+    {
+        template <class Integer>
+        void append_integer(std::string &out, Integer const value)
+        {
+            std::array<char, sizeof(value)> bytes;
+            std::memcpy(bytes.data(), &value, sizeof(value));
+            out.append(bytes.data(), bytes.size());
+        }
+    } // namespace
+
+    void encode(syntax::expression const &tree, std::string &out)
+    {
+        // the kind of node comes first, and the lengths of lists and strings are written in front of them
+        out += static_cast<char>(tree.value.index());
+        std::visit(overloaded{[&out](syntax::string_literal_expression const &literal) {
+                                  append_integer(out, literal.literal.inner_content.size());
+                                  out += literal.literal.inner_content;
+                              },
+                              [&out](syntax::identifier const &identifier_) {
+                                  append_integer(out, identifier_.symbol.value);
+                              },
+                              [&out](syntax::call const &call_) {
+                                  append_integer(out, call_.arguments.size());
+                                  encode(*call_.callee, out);
+                                  for (syntax::expression_ptr const &argument : call_.arguments)
+                                  {
+                                      encode(*argument, out);
+                                  }
+                              },
+                              [&out](syntax::sequence const &sequence_) {
+                                  append_integer(out, sequence_.elements.size());
+                                  for (syntax::expression const &element : sequence_.elements)
+                                  {
+                                      encode(element, out);
+                                  }
+                              },
+                              [&out](syntax::declaration const &declaration_) {
+                                  append_integer(out, declaration_.name.symbol.value);
+                                  encode(*declaration_.initializer, out);
+                              },
+                              [&out](syntax::bool_literal_expression const &literal) {
+                                  out += static_cast<char>(literal.literal.inner_content);
+                              },
+                              [&out](syntax::binary_operator_expression const &binary) {
+                                  out += static_cast<char>(binary.which);
+                                  encode(*binary.left, out);
+                                  encode(*binary.right, out);
+                              },
+                              [&out](syntax::binary_operator_literal_expression const &literal) {
+                                  out += static_cast<char>(literal.which);
+                              }},
+                   tree.value);
+    }
+
+    namespace
+    {
+        struct forward_errors
+        {
+            semantic_error_handler const &on_error;
+            size_t count = 0;
+
+            void operator()(semantic_error error)
+            {
+                ++count;
+                on_error(std::move(error));
+            }
+        };
+
+        // Collects the names that tree declares and the symbols of the identifiers that it uses otherwise.
+        void collect_names(syntax::expression const &tree, std::vector<syntax::symbol_id> &declares,
+                           std::vector<syntax::symbol_id> &uses)
+        {
+            std::visit(overloaded{[&uses](syntax::identifier const &identifier_) {
+                                      uses.emplace_back(identifier_.symbol);
+                                  },
+                                  [&declares, &uses](syntax::call const &call_) {
+                                      collect_names(*call_.callee, declares, uses);
+                                      for (syntax::expression_ptr const &argument : call_.arguments)
+                                      {
+                                          collect_names(*argument, declares, uses);
+                                      }
+                                  },
+                                  [&declares, &uses](syntax::sequence const &sequence_) {
+                                      for (syntax::expression const &element : sequence_.elements)
+                                      {
+                                          collect_names(element, declares, uses);
+                                      }
+                                  },
+                                  [&declares, &uses](syntax::declaration const &declaration_) {
+                                      declares.emplace_back(declaration_.name.symbol);
+                                      collect_names(*declaration_.initializer, declares, uses);
+                                  },
+                                  [&declares, &uses](syntax::binary_operator_expression const &binary) {
+                                      collect_names(*binary.left, declares, uses);
+                                      collect_names(*binary.right, declares, uses);
+                                  },
+                                  [](auto const &) {
+                                      // literals contain no names
+                                  }},
+                       tree.value);
+        }
+
+        // Checks or reuses the elements of the top-level sequence one after another.
+        struct element_checker
+        {
+            forward_errors errors;
+            type_checker<forward_errors &> checker;
+            sequence output;
+            std::vector<checked_element> elements;
+            // the locals that the names used by the element that is being reused referred to before and refer to now
+            std::vector<std::pair<local_id, local_id>> moved_reads;
+
+            explicit element_checker(semantic_error_handler const &on_error)
+                : errors{on_error}
+                , checker(errors)
+            {
+            }
+
+            [[nodiscard]] bool try_reuse(checked_source &previous, checked_element &old)
+            {
+                if (old.has_errors)
+                {
+                    // the locations of the errors may have moved
+                    return false;
+                }
+                for (syntax::symbol_id const declared : old.declares)
+                {
+                    if (checker.named_local_variable(declared))
+                    {
+                        return false;
+                    }
+                }
+                moved_reads.clear();
+                for (name_use const &read : old.reads)
+                {
+                    std::optional<local_id> const found = checker.named_local_variable(read.symbol);
+                    if (!found || (checker.type_of(*found) != previous.locals[read.local.value]))
+                    {
+                        return false;
+                    }
+                    moved_reads.emplace_back(read.local, *found);
+                }
+                // Two names that referred to the same local have to do so still, because the instructions do not say
+                // which of them was used.
+                std::ranges::sort(moved_reads);
+                if (std::ranges::adjacent_find(moved_reads, [](auto const &left, auto const &right) {
+                        return (left.first == right.first) && (left.second != right.second);
+                    }) != moved_reads.end())
+                {
+                    return false;
+                }
+
+                size_t const first_local = checker.locals.size();
+                auto const move_local = [this, &old, first_local](local_id &local) {
+                    if (local.value >= old.first_local)
+                    {
+                        local.value = local.value - old.first_local + first_local;
+                        return;
+                    }
+                    auto const found = std::ranges::lower_bound(moved_reads, local, {}, [](auto const &moved) {
+                        return moved.first;
+                    });
+                    assert((found != moved_reads.end()) && (found->first == local));
+                    local = found->second;
+                };
+                for (name_use &read : old.reads)
+                {
+                    move_local(read.local);
+                }
+                for (name_use &bound : old.binds)
+                {
+                    move_local(bound.local);
+                    checker.bind(bound.symbol, bound.local);
+                }
+                // usually nothing in front of the element has changed, and its instructions can stay as they are
+                bool const is_renumbered =
+                    (first_local != old.first_local) || std::ranges::any_of(moved_reads, [](auto const &moved) {
+                        return moved.first != moved.second;
+                    });
+                size_t const first_instruction = output.elements.size();
+                for (size_t i = 0; i < old.instruction_count; ++i)
+                {
+                    instruction &moving = previous.checked.elements[old.first_instruction + i];
+                    if (is_renumbered)
+                    {
+                        for_each_local(moving, move_local);
+                    }
+                    output.elements.emplace_back(std::move(moving));
+                }
+                auto const old_locals = previous.locals.begin() + static_cast<std::ptrdiff_t>(old.first_local);
+                checker.locals.insert(
+                    checker.locals.end(), old_locals, old_locals + static_cast<std::ptrdiff_t>(old.local_count));
+                old.first_instruction = first_instruction;
+                old.first_local = first_local;
+                elements.emplace_back(std::move(old));
+                return true;
+            }
+
+            void check(syntax::expression const &element)
+            {
+                checked_element result;
+                result.hash = element.hash;
+                encode(element, result.encoded);
+                result.first_instruction = output.elements.size();
+                result.first_local = checker.locals.size();
+
+                // Only the uses of names from in front of the element are recorded. Any other name is either declared
+                // inside, or the use is an error and the element will be checked again anyway.
+                std::vector<syntax::symbol_id> uses;
+                collect_names(element, result.declares, uses);
+                for (syntax::symbol_id const symbol : uses)
+                {
+                    if (symbol == syntax::print_symbol)
+                    {
+                        continue;
+                    }
+                    if (std::optional<local_id> const found = checker.named_local_variable(symbol))
+                    {
+                        result.reads.emplace_back(name_use{symbol, *found});
+                    }
+                }
+                std::ranges::sort(result.reads, {}, [](name_use const &read) {
+                    return read.symbol;
+                });
+                auto const repeated_reads = std::ranges::unique(result.reads, {}, [](name_use const &read) {
+                    return read.symbol;
+                });
+                result.reads.erase(repeated_reads.begin(), repeated_reads.end());
+
+                size_t const errors_before = errors.count;
+                size_t const bindings_before = checker.bound_symbols.size();
+                (void)checker.check_expression(element, output);
+                result.instruction_count = output.elements.size() - result.first_instruction;
+                result.local_count = checker.locals.size() - result.first_local;
+                for (size_t i = bindings_before; i < checker.bound_symbols.size(); ++i)
+                {
+                    syntax::symbol_id const bound = checker.bound_symbols[i];
+                    result.binds.emplace_back(name_use{bound, *checker.named_local_variable(bound)});
+                }
+                result.has_errors = (errors.count != errors_before);
+                elements.emplace_back(std::move(result));
+            }
+        };
+    } // namespace
+
+    checked_source check_source(syntax::sequence const &parsed, semantic_error_handler const &on_error)
+    {
+        return check_again(checked_source{}, parsed, on_error);
+    }
+
+    checked_source check_again(checked_source previous, syntax::sequence const &parsed,
+                               semantic_error_handler const &on_error)
+    {
+        element_checker state(on_error);
+        if (parsed.elements.empty())
+        {
+            (void)state.checker.check_sequence(parsed, state.output);
+            return checked_source{std::move(state.output), std::move(state.checker.locals), {}};
+        }
+
+        size_t const old_count = previous.elements.size();
+        size_t const new_count = parsed.elements.size();
+        size_t const common = std::min(old_count, new_count);
+        // the hashes tell most different elements apart without encoding them
+        std::string encoded;
+        auto const is_same = [&encoded](checked_element const &old, syntax::expression const &element) {
+            if (old.hash != element.hash)
+            {
+                return false;
+            }
+            encoded.clear();
+            encode(element, encoded);
+            return (encoded == old.encoded);
+        };
+        size_t prefix = 0;
+        while ((prefix < common) && is_same(previous.elements[prefix], parsed.elements[prefix]))
+        {
+            ++prefix;
+        }
+        size_t suffix = 0;
+        while ((suffix < (common - prefix)) &&
+               is_same(previous.elements[old_count - 1 - suffix], parsed.elements[new_count - 1 - suffix]))
+        {
+            ++suffix;
+        }
+
+        state.elements.reserve(new_count);
+        state.output.elements.reserve(previous.checked.elements.size());
+        state.checker.locals.reserve(previous.locals.size());
+        for (size_t i = 0; i < new_count; ++i)
+        {
+            checked_element *const old = (i < prefix)                 ? &previous.elements[i]
+                                         : (i >= (new_count - suffix)) ? &previous.elements[old_count - (new_count - i)]
+                                                                       : nullptr;
+            if (!old || !state.try_reuse(previous, *old))
+            {
+                state.check(parsed.elements[i]);
+            }
+        }
+        return checked_source{std::move(state.output), std::move(state.checker.locals), std::move(state.elements)};
+    }
+} // namespace lpg::semantics
@@ -0,0 +1,59 @@
+#pragma once
+#include "type_checker.h"
+
+namespace lpg::semantics
+{
+    // A top-level name that an element uses, and the local that the name referred to.
+    struct name_use
+    {
+        syntax::symbol_id symbol;
+        local_id local;
+    };
+
+    // What an element of the top-level sequence was checked to, and what it depends on.
+    struct checked_element
+    {
+        syntax::tree_hash hash = 0;
+        // The element without its locations, as written by encode. A matching hash is confirmed with it, because
+        // apply_edit updates the previous tree in place and the previous source may be gone.
+        std::string encoded;
+        size_t first_instruction = 0;
+        size_t instruction_count = 0;
+        size_t first_local = 0;
+        size_t local_count = 0;
+        // the names that were declared in front of the element and that it uses
+        std::vector<name_use> reads;
+        // the names that it declares anywhere inside, which must not be in scope in front of it
+        std::vector<syntax::symbol_id> declares;
+        // the names that it binds for the elements behind it, in the order of binding, like let a = let b = "x"
+        std::vector<name_use> binds;
+        bool has_errors = false;
+    };
+
+    // What has to be kept between edits to check a program incrementally.
+    struct checked_source
+    {
+        sequence checked;
+        std::pmr::vector<type> locals;
+        std::vector<checked_element> elements;
+    };
+
+    // Appends everything about tree except for its locations to out, so that two trees have the same encoding exactly
+    // when they are equal except for their locations. Names are written as their symbol ids.
+    void encode(syntax::expression const &tree, std::string &out);
+
+    // Checks like check_types, but keeps what check_again needs.
+    [[nodiscard]] checked_source check_source(syntax::sequence const &parsed, semantic_error_handler const &on_error);
+
+    // Checks parsed, which is the tree that previous was checked from after an edit. The elements of the top-level
+    // sequence are matched with the previous ones from the front and from the back. Two elements match if their
+    // hashes are equal and their encodings confirm that they are equal except for their locations. A matched element
+    // is not checked again if it had no errors, every name that it uses still refers to a local of the same type and
+    // none of the names that it declares is in scope in front of it. Its instructions are moved and renumbered
+    // instead. Every other element is checked again, so a changed declaration only costs the elements that use it.
+    // The result is the same as that of check_types, and on_error is called with the same errors in the same order.
+    // parsed has to use the same symbol ids as the previous tree, which apply_edit keeps, and its hashes have to be
+    // up to date.
+    [[nodiscard]] checked_source check_again(checked_source previous, syntax::sequence const &parsed,
+                                             semantic_error_handler const &on_error);
+} // namespace lpg::semantics
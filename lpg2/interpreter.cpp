@@ -1,4 +1,6 @@
 #include "interpreter.h"
+#include "constant_folding.h"
+#include "dead_instruction_elimination.h"
 #include "overloaded.h"
 #include "type_checker.h"
 #include <boost/outcome/result.hpp>
@@ -21,13 +23,18 @@ namespace lpg
         {
         };
 
-        using value = std::variant<std::string, semantics::builtin_functions, void_, bool>;
+        using value = std::variant<std::pmr::string, semantics::builtin_functions, void_, bool>;
 
         struct interpreter final
         {
-            std::vector<std::optional<value>> locals;
+            std::pmr::vector<std::optional<value>> locals;
             std::string print_output;
 
+            explicit interpreter(std::pmr::memory_resource *const resource)
+                : locals(resource)
+            {
+            }
+
             [[nodiscard]] std::optional<evaluate_error> initialize_local(semantics::local_id const id,
                                                                          value initializer)
             {
@@ -44,14 +51,17 @@ namespace lpg
                 return std::nullopt;
             }
 
-            [[nodiscard]] boost::outcome_v2::result<value, evaluate_error> read_local(semantics::local_id const id)
+            // Returns a pointer instead of a copy so that strings are not copied out of the memory_resource. It is
+            // invalidated by initialize_local.
+            [[nodiscard]] boost::outcome_v2::result<value const *, evaluate_error>
+            read_local(semantics::local_id const id)
             {
                 std::optional<value> const &local = locals[id.value];
                 if (!local)
                 {
                     return evaluate_error{evaluate_error_type::read_uninitialized_local};
                 }
-                return *local;
+                return &*local;
             }
         };
 
@@ -67,26 +77,26 @@ namespace lpg
                         return context.initialize_local(builtin_instruction.destination, builtin_instruction.function);
                     },
                     [&context](semantics::call const &call_instruction) -> std::optional<evaluate_error> {
-                        boost::outcome_v2::result<value, evaluate_error> const maybe_callee =
+                        boost::outcome_v2::result<value const *, evaluate_error> const maybe_callee =
                             context.read_local(call_instruction.callee);
                         if (maybe_callee.has_error())
                         {
                             return maybe_callee.assume_error();
                         }
-                        std::vector<value> arguments;
+                        std::pmr::vector<value const *> arguments(context.locals.get_allocator());
                         arguments.reserve(call_instruction.arguments.size());
                         for (semantics::local_id const argument : call_instruction.arguments)
                         {
-                            boost::outcome_v2::result<value, evaluate_error> const maybe_argument =
+                            boost::outcome_v2::result<value const *, evaluate_error> const maybe_argument =
                                 context.read_local(argument);
                             if (maybe_argument.has_error())
                             {
                                 return maybe_argument.assume_error();
                             }
-                            arguments.emplace_back(std::move(maybe_argument.assume_value()));
+                            arguments.emplace_back(maybe_argument.assume_value());
                         }
                         semantics::builtin_functions const *const builtin =
-                            std::get_if<semantics::builtin_functions>(&maybe_callee.assume_value());
+                            std::get_if<semantics::builtin_functions>(maybe_callee.assume_value());
                         if (!builtin)
                         {
                             return evaluate_error{evaluate_error_type::not_callable};
@@ -98,7 +108,7 @@ namespace lpg
                             {
                                 return evaluate_error{evaluate_error_type::invalid_argument_count};
                             }
-                            std::string const *const message = std::get_if<std::string>(&arguments[0]);
+                            std::pmr::string const *const message = std::get_if<std::pmr::string>(arguments[0]);
                             if (!message)
                             {
                                 return evaluate_error{evaluate_error_type::invalid_argument_type};
@@ -111,12 +121,12 @@ namespace lpg
                             {
                                 return evaluate_error{evaluate_error_type::invalid_argument_count};
                             }
-                            std::string const *const left = std::get_if<std::string>(&arguments[0]);
+                            std::pmr::string const *const left = std::get_if<std::pmr::string>(arguments[0]);
                             if (!left)
                             {
                                 return evaluate_error{evaluate_error_type::invalid_argument_type};
                             }
-                            std::string const *const right = std::get_if<std::string>(&arguments[1]);
+                            std::pmr::string const *const right = std::get_if<std::pmr::string>(arguments[1]);
                             if (!right)
                             {
                                 return evaluate_error{evaluate_error_type::invalid_argument_type};
@@ -128,8 +138,11 @@ namespace lpg
                     },
                     [&context](
                         semantics::string_literal const &string_literal_instruction) -> std::optional<evaluate_error> {
+                        // copied into the memory_resource of the interpreter
                         return context.initialize_local(
-                            string_literal_instruction.destination, string_literal_instruction.value);
+                            string_literal_instruction.destination,
+                            value(std::in_place_type<std::pmr::string>, string_literal_instruction.value,
+                                  context.locals.get_allocator()));
                     },
                     [&context](semantics::sequence const &sequence_instruction) -> std::optional<evaluate_error> {
                         return run_sequence(context, sequence_instruction);
@@ -163,18 +176,32 @@ namespace lpg
         }
     } // namespace
 
-    run_result run(std::string_view source, std::function<void(syntax::parse_error)> on_syntax_error,
-                   semantics::semantic_error_handler on_semantic_error)
+    run_result evaluate(semantics::sequence const &program, std::pmr::memory_resource *const resource)
     {
-        assert(on_syntax_error);
-        assert(on_semantic_error);
-        syntax::sequence parsed = compile(source, move(on_syntax_error));
-        semantics::sequence const checked = semantics::check_types(parsed, move(on_semantic_error));
-        interpreter context;
-        if (std::optional<evaluate_error> error = run_sequence(context, checked))
+        interpreter context(resource);
+        if (std::optional<evaluate_error> error = run_sequence(context, program))
         {
             return std::move(*error);
         }
         return std::move(context.print_output);
     }
+
+    run_result run(std::string_view source, std::function<void(syntax::parse_error)> on_syntax_error,
+                   semantics::semantic_error_handler on_semantic_error, std::pmr::memory_resource *const resource)
+    {
+        assert(on_syntax_error);
+        assert(on_semantic_error);
+        syntax::sequence parsed = syntax::compile(source, on_syntax_error, syntax::default_max_depth, resource);
+        semantics::sequence const checked = semantics::check_types(parsed, move(on_semantic_error), resource);
+        semantics::sequence program = semantics::fold_constants(checked, resource);
+        semantics::eliminate_dead_instructions(program);
+        return evaluate(program, resource);
+    }
+
+    run_result run_file(std::filesystem::path const &path, std::function<void(syntax::parse_error)> on_syntax_error,
+                        semantics::semantic_error_handler on_semantic_error, std::pmr::memory_resource *const resource)
+    {
+        source_file const source(path);
+        return run(source.content(), move(on_syntax_error), move(on_semantic_error), resource);
+    }
 } // namespace lpg
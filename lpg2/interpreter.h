@@ -28,6 +28,20 @@ namespace lpg
 
     using run_result = std::variant<std::string, evaluate_error>;
 
+    // Runs instructions from check_types. The values are allocated from resource.
+    [[nodiscard]] run_result evaluate(semantics::sequence const &program,
+                                      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    // Folds the constants of the checked program and removes its dead instructions before it is evaluated. The syntax
+    // tree, the instructions and the values of the program are allocated from resource. A
+    // std::pmr::monotonic_buffer_resource makes them cheap to allocate and releases them all at once afterwards.
     [[nodiscard]] run_result run(std::string_view source, std::function<void(syntax::parse_error)> on_syntax_error,
-                                 semantics::semantic_error_handler on_semantic_error);
+                                 semantics::semantic_error_handler on_semantic_error,
+                                 std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    // Like run, but reads the source from a memory-mapped file. Throws like the constructor of source_file.
+    [[nodiscard]] run_result run_file(std::filesystem::path const &path,
+                                      std::function<void(syntax::parse_error)> on_syntax_error,
+                                      semantics::semantic_error_handler on_semantic_error,
+                                      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 } // namespace lpg
@@ -0,0 +1,114 @@
+#include "lazy.h"
+#include <algorithm>
+
+namespace lpg::syntax
+{
+    lazy_source preparse(std::string_view const source, std::function<void(parse_error)> const &on_error,
+                         size_t const max_depth)
+    {
+        token_buffer tokens = tokenize_all(source);
+        brace_index braces = index_braces(tokens);
+        parser<std::function<void(parse_error)> const &> top_level(token_cursor{source, std::move(tokens)}, on_error);
+        top_level.max_depth = max_depth;
+        top_level.braces = &braces;
+        sequence parsed = top_level.parse_sequence(false, source_location{0});
+        if (top_level.tokens.has_failed)
+        {
+            top_level.report(message_id::tokenization_failed, top_level.tokens.next_location);
+        }
+        lazy_source result{
+            source, std::move(top_level.tokens.tokens), std::move(braces), max_depth, std::move(parsed), {}};
+        for (skipped_block const &block : top_level.skipped_blocks)
+        {
+            result.unexpanded.emplace(block.left_brace, block.depth);
+        }
+        return result;
+    }
+
+    namespace
+    {
+        // Like expand, but leaves the hashes alone.
+        void expand_block(lazy_source &source, sequence &block, std::function<void(parse_error)> const &on_error)
+        {
+            std::vector<std::uint32_t> const &offsets = source.tokens.offsets;
+            auto const brace = std::lower_bound(offsets.begin(), offsets.end(), block.location.offset);
+            if ((brace == offsets.end()) || (*brace != block.location.offset))
+            {
+                return;
+            }
+            auto const found = source.unexpanded.find(static_cast<std::uint32_t>(brace - offsets.begin()));
+            if (found == source.unexpanded.end())
+            {
+                return;
+            }
+            std::uint32_t const left_brace = found->first;
+            std::uint32_t const depth = found->second;
+            source.unexpanded.erase(found);
+
+            parser<std::function<void(parse_error)> const &> block_parser(
+                token_cursor{source.source, std::move(source.tokens)}, on_error);
+            block_parser.max_depth = source.max_depth - depth;
+            block_parser.braces = &source.braces;
+            block_parser.tokens.next_token = left_brace + 1;
+            block = block_parser.parse_sequence(true, block.location);
+            source.tokens = std::move(block_parser.tokens.tokens);
+            for (skipped_block const &inner : block_parser.skipped_blocks)
+            {
+                source.unexpanded.emplace(inner.left_brace, depth + inner.depth);
+            }
+        }
+    } // namespace
+
+    void expand(lazy_source &source, sequence &block, std::function<void(parse_error)> const &on_error)
+    {
+        expand_block(source, block, on_error);
+        std::vector<expression *> path;
+        if (find_block(source.parsed, block.location, path) == &block)
+        {
+            for (auto i = path.rbegin(); i != path.rend(); ++i)
+            {
+                (*i)->hash = expression::hash_node((*i)->value);
+            }
+        }
+    }
+
+    void expand_all(lazy_source &source, std::function<void(parse_error)> const &on_error)
+    {
+        // a stack instead of recursion, because the tree may be as deep as max_depth
+        std::vector<expression *> pending;
+        auto const add_elements = [&pending](sequence &block) {
+            for (expression &element : block.elements)
+            {
+                pending.emplace_back(&element);
+            }
+        };
+        add_elements(source.parsed);
+        while (!pending.empty())
+        {
+            expression &next = *pending.back();
+            pending.pop_back();
+            std::visit(overloaded{[&](call &call_) {
+                                      pending.emplace_back(call_.callee.get());
+                                      for (expression_ptr &argument : call_.arguments)
+                                      {
+                                          pending.emplace_back(argument.get());
+                                      }
+                                  },
+                                  [&](sequence &block) {
+                                      expand_block(source, block, on_error);
+                                      add_elements(block);
+                                  },
+                                  [&](declaration &declaration_) {
+                                      pending.emplace_back(declaration_.initializer.get());
+                                  },
+                                  [&](binary_operator_expression &binary) {
+                                      pending.emplace_back(binary.left.get());
+                                      pending.emplace_back(binary.right.get());
+                                  },
+                                  [](auto &) {
+                                  }},
+                       next.value);
+        }
+        update_hashes(source.parsed);
+    }
+} // namespace lpg::syntax
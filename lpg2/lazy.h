@@ -0,0 +1,34 @@
+#pragma once
+#include "parser.h"
+#include <unordered_map>
+
+namespace lpg::syntax
+{
+    // A parse that leaves brace blocks empty until they are needed, so that the time to open a large source depends on
+    // its top-level structure rather than on its size.
+    struct lazy_source
+    {
+        std::string_view source;
+        token_buffer tokens;
+        brace_index braces;
+        size_t max_depth = default_max_depth;
+        // The blocks in here are empty until they are expanded.
+        sequence parsed;
+        // the depth of the blocks that have not been expanded yet, by the token of their left brace
+        std::unordered_map<std::uint32_t, std::uint32_t> unexpanded;
+    };
+
+    // Parses only the top level of source. A block whose left brace has no matching right brace is parsed right away.
+    // Errors inside of the other blocks are reported when they are expanded.
+    [[nodiscard]] lazy_source preparse(std::string_view source, std::function<void(parse_error)> const &on_error,
+                                       size_t max_depth = default_max_depth);
+
+    // Parses the contents of block unless that has happened already. The blocks inside of it stay unexpanded. block
+    // has to be a brace block in source.parsed, not source.parsed itself. After an error the parser continues behind
+    // the block instead of wherever compile would, so the trees are only guaranteed to be the same without errors.
+    // The hashes of the expressions from the top level down to block are computed again.
+    void expand(lazy_source &source, sequence &block, std::function<void(parse_error)> const &on_error);
+
+    // Expands every block, which gives the tree of compile for a program without errors, and updates the hashes.
+    void expand_all(lazy_source &source, std::function<void(parse_error)> const &on_error);
+} // namespace lpg::syntax
@@ -0,0 +1,43 @@
+#include "line_index.h"
+#include <algorithm>
+
+namespace lpg::syntax
+{
+    std::ostream &operator<<(std::ostream &out, const line_and_column &value)
+    {
+        return out << (value.line + 1) << ":" << (value.column + 1);
+    }
+
+    line_index::line_index(std::string_view source)
+        : source(source)
+    {
+    }
+
+    line_and_column line_index::locate(source_location const where)
+    {
+        assert(where.offset <= source.size());
+        if (line_beginnings.empty())
+        {
+            simd::kernels const &kernels = simd::best_kernels();
+            char const *const begin = source.data();
+            char const *const end = begin + source.size();
+            line_beginnings.reserve(kernels.count_new_lines(begin, end) + 1);
+            line_beginnings.emplace_back(0);
+            for (char const *new_line = kernels.find_new_line(begin, end); new_line != end;
+                 new_line = kernels.find_new_line(new_line + 1, end))
+            {
+                line_beginnings.emplace_back(static_cast<std::uint32_t>(new_line + 1 - begin));
+            }
+        }
+        auto const next_line = std::upper_bound(line_beginnings.begin(), line_beginnings.end(), where.offset);
+        auto const line = static_cast<size_t>(next_line - line_beginnings.begin()) - 1;
+        // every code point has exactly one byte that is not a continuation byte 10xxxxxx
+        auto const is_code_point_start = [](char const c) {
+            return (static_cast<unsigned char>(c) & 0xc0) != 0x80;
+        };
+        std::uint32_t const line_begin = line_beginnings[line];
+        std::string_view const in_front = source.substr(line_begin, where.offset - line_begin);
+        return line_and_column{
+            line, static_cast<size_t>(std::count_if(in_front.begin(), in_front.end(), is_code_point_start))};
+    }
+} // namespace lpg::syntax
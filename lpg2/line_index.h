@@ -0,0 +1,30 @@
+#pragma once
+#include "tokenizer.h"
+#include <vector>
+
+namespace lpg::syntax
+{
+    struct line_and_column
+    {
+        size_t line = 0;
+        // in code points, because that is what editors show
+        size_t column = 0;
+
+        std::weak_ordering operator<=>(line_and_column const &other) const noexcept = default;
+    };
+
+    std::ostream &operator<<(std::ostream &out, const line_and_column &value);
+
+    // Turns source_locations into lines and columns. The index of line beginnings is built on the first lookup, so
+    // nothing is paid for it unless a location is actually shown to someone.
+    struct line_index
+    {
+        std::string_view source;
+        // empty until the first call to locate
+        std::vector<std::uint32_t> line_beginnings;
+
+        explicit line_index(std::string_view source);
+
+        [[nodiscard]] line_and_column locate(source_location where);
+    };
+} // namespace lpg::syntax
@@ -0,0 +1,218 @@
+#include "parallel_tokenizer.h"
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace lpg::syntax
+{
+    namespace
+    {
+        struct chunk_bounds
+        {
+            std::uint32_t begin;
+            std::uint32_t end;
+        };
+
+        // The two speculative results for one chunk. Offsets in the token buffers are relative to where lexing began.
+        struct chunk_result
+        {
+            // lexed from the beginning of the chunk, assuming that it is not inside a string literal
+            token_buffer outside;
+            // assuming that the chunk begins inside a string literal: one past the quote that closes it
+            std::optional<std::uint32_t> string_end;
+            // lexed from string_end
+            token_buffer inside;
+        };
+
+        [[nodiscard]] std::vector<chunk_bounds> split_after_new_lines(std::string_view const source,
+                                                                      size_t const chunk_count,
+                                                                      simd::kernels const &kernels)
+        {
+            std::vector<chunk_bounds> chunks;
+            char const *const begin = source.data();
+            char const *const end = begin + source.size();
+            char const *chunk_begin = begin;
+            for (size_t i = 1; i <= chunk_count; ++i)
+            {
+                char const *chunk_end = end;
+                if (i < chunk_count)
+                {
+                    char const *const target = begin + (source.size() / chunk_count) * i;
+                    if (target <= chunk_begin)
+                    {
+                        continue;
+                    }
+                    char const *const new_line = kernels.find_new_line(target, end);
+                    chunk_end = (new_line == end) ? end : (new_line + 1);
+                }
+                chunks.emplace_back(chunk_bounds{static_cast<std::uint32_t>(chunk_begin - begin),
+                                                 static_cast<std::uint32_t>(chunk_end - begin)});
+                chunk_begin = chunk_end;
+                if (chunk_begin == end)
+                {
+                    break;
+                }
+            }
+            return chunks;
+        }
+
+        [[nodiscard]] chunk_result lex_chunk(std::string_view const source, chunk_bounds const chunk,
+                                             bool const is_first, simd::kernels const &kernels)
+        {
+            std::string_view const text = source.substr(chunk.begin, chunk.end - chunk.begin);
+            chunk_result result;
+            result.outside = tokenize_all(text, kernels);
+            if (is_first)
+            {
+                return result;
+            }
+            char const *const quote = kernels.find_quote(text.data(), text.data() + text.size());
+            if (quote == (text.data() + text.size()))
+            {
+                return result;
+            }
+            std::uint32_t const string_end = static_cast<std::uint32_t>(quote + 1 - text.data());
+            result.string_end = string_end;
+            result.inside = tokenize_all(text.substr(string_end), kernels);
+            return result;
+        }
+
+        void append_tokens(token_buffer &into, token_buffer const &from, std::uint32_t const offset)
+        {
+            into.kinds.insert(into.kinds.end(), from.kinds.begin(), from.kinds.end());
+            into.lengths.insert(into.lengths.end(), from.lengths.begin(), from.lengths.end());
+            for (std::uint32_t const relative : from.offsets)
+            {
+                into.offsets.emplace_back(offset + relative);
+            }
+            // Both tables number the names in order of first appearance, so interning the chunk's names in its own
+            // order gives the same ids as lexing serially.
+            std::vector<symbol_id> renumbered(from.symbols.size());
+            for (size_t i = 0; i < renumbered.size(); ++i)
+            {
+                renumbered[i] = into.symbols.intern(from.symbols.name(symbol_id{static_cast<std::uint32_t>(i)}));
+            }
+            for (size_t i = 0; i < from.size(); ++i)
+            {
+                into.symbol_ids.emplace_back((from.kinds[i] == token_kind::identifier)
+                                                 ? renumbered[from.symbol_ids[i].value]
+                                                 : symbol_id{});
+            }
+        }
+    } // namespace
+
+    token_buffer tokenize_parallel(std::string_view const source, size_t const chunk_count,
+                                   simd::kernels const &kernels)
+    {
+        if (source.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("The source is too large for 32-bit token offsets");
+        }
+        std::vector<chunk_bounds> const chunks =
+            split_after_new_lines(source, std::max<size_t>(chunk_count, 1), kernels);
+        if (chunks.size() <= 1)
+        {
+            return tokenize_all(source, kernels);
+        }
+
+        std::vector<std::future<chunk_result>> pending;
+        pending.reserve(chunks.size() - 1);
+        for (size_t i = 1; i < chunks.size(); ++i)
+        {
+            pending.emplace_back(
+                std::async(std::launch::async, lex_chunk, source, chunks[i], false, std::cref(kernels)));
+        }
+        std::vector<chunk_result> results;
+        results.reserve(chunks.size());
+        results.emplace_back(lex_chunk(source, chunks[0], true, kernels));
+        for (std::future<chunk_result> &result : pending)
+        {
+            results.emplace_back(result.get());
+        }
+
+        token_buffer merged;
+        size_t capacity = 0;
+        for (chunk_result const &result : results)
+        {
+            // one more for a string literal that ends in this chunk
+            capacity += std::max(result.outside.size(), result.inside.size() + 1);
+        }
+        merged.kinds.reserve(capacity);
+        merged.offsets.reserve(capacity);
+        merged.lengths.reserve(capacity);
+        merged.symbol_ids.reserve(capacity);
+        // the opening quote of a string literal that continues into the current chunk
+        std::optional<std::uint32_t> open_string;
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            chunk_result const &result = results[i];
+            token_buffer const *tokens = &result.outside;
+            std::uint32_t tokens_begin = chunks[i].begin;
+            if (open_string)
+            {
+                if (!result.string_end)
+                {
+                    continue;
+                }
+                std::uint32_t const string_end = chunks[i].begin + *result.string_end;
+                // the chunks have only seen parts of this literal
+                char const *const content = source.data() + *open_string + 1;
+                char const *const content_end = source.data() + string_end - 1;
+                char const *const invalid = kernels.find_invalid_utf8(content, content_end);
+                if (invalid != content_end)
+                {
+                    merged.has_failed = true;
+                    merged.has_invalid_utf8 = true;
+                    merged.end_offset = static_cast<std::uint32_t>(invalid - source.data());
+                    return merged;
+                }
+                merged.kinds.emplace_back(token_kind::string_literal);
+                merged.offsets.emplace_back(*open_string);
+                merged.lengths.emplace_back(string_end - *open_string);
+                merged.symbol_ids.emplace_back();
+                open_string = std::nullopt;
+                tokens = &result.inside;
+                tokens_begin = string_end;
+            }
+            append_tokens(merged, *tokens, tokens_begin);
+            std::uint32_t const stopped = tokens_begin + tokens->end_offset;
+            if (tokens->has_invalid_utf8)
+            {
+                merged.has_failed = true;
+                merged.has_invalid_utf8 = true;
+                merged.end_offset = stopped;
+                return merged;
+            }
+            if (tokens->has_failed)
+            {
+                open_string = stopped;
+            }
+            else if (stopped != chunks[i].end)
+            {
+                // an invalid character ends tokenization
+                merged.end_offset = stopped;
+                return merged;
+            }
+        }
+        if (open_string)
+        {
+            merged.has_failed = true;
+            merged.end_offset = *open_string;
+        }
+        else
+        {
+            merged.end_offset = static_cast<std::uint32_t>(source.size());
+        }
+        return merged;
+    }
+
+    token_buffer tokenize_parallel(std::string_view const source)
+    {
+        size_t const thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        size_t const chunk_count = std::min(thread_count, (source.size() / minimum_parallel_chunk_size) + 1);
+        return tokenize_parallel(source, chunk_count, simd::best_kernels());
+    }
+} // namespace lpg::syntax
@@ -0,0 +1,17 @@
+#pragma once
+#include "token_buffer.h"
+
+namespace lpg::syntax
+{
+    inline constexpr size_t minimum_parallel_chunk_size = size_t{1} << 20;
+
+    // Lexes the source in up to chunk_count chunks that are split after new lines and processed concurrently. A chunk
+    // may begin inside a multi-line string literal, so every chunk but the first is lexed twice: once from the
+    // beginning and once from its first quote. A sequential pass then picks the right result for each chunk.
+    // The result is the same as that of tokenize_all. Throws std::length_error like tokenize_all.
+    [[nodiscard]] token_buffer tokenize_parallel(std::string_view source, size_t chunk_count,
+                                                 simd::kernels const &kernels);
+
+    // Uses one chunk per hardware thread, but no chunks smaller than minimum_parallel_chunk_size.
+    [[nodiscard]] token_buffer tokenize_parallel(std::string_view source);
+} // namespace lpg::syntax
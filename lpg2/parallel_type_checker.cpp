@@ -0,0 +1,210 @@
+#include "parallel_type_checker.h"
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <thread>
+
+namespace lpg::semantics
+{
+    namespace
+    {
+        struct buffer_errors
+        {
+            std::vector<semantic_error> errors;
+
+            void operator()(semantic_error error)
+            {
+                errors.emplace_back(std::move(error));
+            }
+        };
+
+        // A block at the top level that is checked apart from the code around it.
+        struct deferred_block
+        {
+            syntax::node_index node;
+            size_t node_count;
+            // what the code in front of the block has produced when the block would have been checked
+            size_t first_local;
+            size_t instructions_before;
+            size_t bindings_before;
+            size_t errors_before;
+        };
+
+        struct checked_block
+        {
+            sequence instructions;
+            size_t local_count = 0;
+            std::vector<semantic_error> errors;
+        };
+
+        void check_blocks(syntax::flat_tree const &input, enclosing_scope const &around,
+                          std::span<deferred_block const> const blocks, std::span<checked_block> const results)
+        {
+            buffer_errors errors;
+            type_checker<buffer_errors &> checker(errors);
+            enclosing_scope scope = around;
+            checker.enclosing = &scope;
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                scope.visible_bindings = blocks[i].bindings_before;
+                checker.first_local = blocks[i].first_local;
+                checker.locals.clear();
+                // a block leaves no names behind, so the checker can be reused for the next one
+                (void)checker.check_expression(input, blocks[i].node, results[i].instructions);
+                results[i].local_count = checker.locals.size();
+                results[i].errors = std::move(errors.errors);
+                errors.errors.clear();
+            }
+        }
+    } // namespace
+
+    sequence check_types_parallel(syntax::flat_tree const &input, semantic_error_handler const &on_error,
+                                  size_t const thread_count, size_t const minimum_block_size)
+    {
+        buffer_errors outside_errors;
+        type_checker<buffer_errors &> checker(outside_errors);
+        sequence outside;
+        std::vector<deferred_block> blocks;
+        syntax::node_data const root = input.data[input.root().value];
+        std::span<syntax::node_index const> const elements = input.list(root.first, root.second);
+        if (elements.empty())
+        {
+            (void)checker.check_sequence(input, root, outside);
+        }
+        // The nodes of a subtree are contiguous and end with its root, so the elements divide the nodes in front of
+        // the root.
+        std::uint32_t subtree_begin = 0;
+        for (syntax::node_index const element : elements)
+        {
+            size_t const node_count = element.value + 1 - subtree_begin;
+            subtree_begin = element.value + 1;
+            if ((thread_count > 1) && (input.kinds[element.value] == syntax::node_kind::sequence) &&
+                (node_count >= minimum_block_size))
+            {
+                blocks.emplace_back(deferred_block{element, node_count, checker.locals.size(), outside.elements.size(),
+                                                   checker.bound_symbols.size(), outside_errors.errors.size()});
+            }
+            else
+            {
+                (void)checker.check_expression(input, element, outside);
+            }
+        }
+
+        std::vector<checked_block> results(blocks.size());
+        if (!blocks.empty())
+        {
+            // The names in scope at the top level have been bound in this order, and a block sees the first
+            // bindings_before of them.
+            std::vector<std::uint32_t> binding_positions(
+                checker.named_local_variables.size(), std::numeric_limits<std::uint32_t>::max());
+            for (size_t i = 0; i < checker.bound_symbols.size(); ++i)
+            {
+                binding_positions[checker.bound_symbols[i].value] = static_cast<std::uint32_t>(i);
+            }
+            enclosing_scope const around{checker.locals, checker.named_local_variables, binding_positions, 0};
+
+            // contiguous groups of blocks with about the same number of nodes
+            size_t total_nodes = 0;
+            for (deferred_block const &block : blocks)
+            {
+                total_nodes += block.node_count;
+            }
+            size_t const group_count = std::min(thread_count, blocks.size());
+            std::vector<size_t> group_ends;
+            size_t nodes_so_far = 0;
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                nodes_so_far += blocks[i].node_count;
+                if ((nodes_so_far * group_count) >= (total_nodes * (group_ends.size() + 1)))
+                {
+                    group_ends.emplace_back(i + 1);
+                }
+            }
+            std::vector<std::future<void>> pending;
+            std::span<deferred_block const> const all_blocks = blocks;
+            std::span<checked_block> const all_results = results;
+            for (size_t i = 1; i < group_ends.size(); ++i)
+            {
+                size_t const begin = group_ends[i - 1];
+                size_t const length = group_ends[i] - begin;
+                pending.emplace_back(std::async(std::launch::async, check_blocks, std::cref(input), std::cref(around),
+                                                all_blocks.subspan(begin, length),
+                                                all_results.subspan(begin, length)));
+            }
+            check_blocks(input, around, all_blocks.first(group_ends[0]), all_results.first(group_ends[0]));
+            for (std::future<void> &group : pending)
+            {
+                group.get();
+            }
+        }
+
+        // The locals of a block come between those that were allocated in front of it and behind it.
+        std::vector<size_t> block_first_locals;
+        std::vector<size_t> block_locals_before{0};
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            block_first_locals.emplace_back(blocks[i].first_local);
+            block_locals_before.emplace_back(block_locals_before.back() + results[i].local_count);
+        }
+        auto const move_outside_local = [&block_first_locals, &block_locals_before](local_id &local) {
+            size_t const blocks_in_front = static_cast<size_t>(
+                std::upper_bound(block_first_locals.begin(), block_first_locals.end(), local.value) -
+                block_first_locals.begin());
+            local.value += block_locals_before[blocks_in_front];
+        };
+
+        sequence result;
+        size_t instructions = outside.elements.size();
+        for (checked_block const &block : results)
+        {
+            instructions += block.instructions.elements.size();
+        }
+        result.elements.reserve(instructions);
+        size_t next_instruction = 0;
+        size_t next_error = 0;
+        auto const take_outside = [&](size_t const instructions_end, size_t const errors_end) {
+            for (; next_instruction < instructions_end; ++next_instruction)
+            {
+                instruction &element = outside.elements[next_instruction];
+                for_each_local(element, move_outside_local);
+                result.elements.emplace_back(std::move(element));
+            }
+            for (; next_error < errors_end; ++next_error)
+            {
+                on_error(std::move(outside_errors.errors[next_error]));
+            }
+        };
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            take_outside(blocks[i].instructions_before, blocks[i].errors_before);
+            size_t const first_local = blocks[i].first_local;
+            size_t const shift = block_locals_before[i];
+            for (instruction &element : results[i].instructions.elements)
+            {
+                for_each_local(element, [&move_outside_local, first_local, shift](local_id &local) {
+                    if (local.value < first_local)
+                    {
+                        move_outside_local(local);
+                    }
+                    else
+                    {
+                        local.value += shift;
+                    }
+                });
+                result.elements.emplace_back(std::move(element));
+            }
+            for (semantic_error &error : results[i].errors)
+            {
+                on_error(std::move(error));
+            }
+        }
+        take_outside(outside.elements.size(), outside_errors.errors.size());
+        return result;
+    }
+
+    sequence check_types_parallel(syntax::flat_tree const &input, semantic_error_handler const &on_error)
+    {
+        size_t const thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        return check_types_parallel(input, on_error, thread_count, minimum_parallel_block_size);
+    }
+} // namespace lpg::semantics
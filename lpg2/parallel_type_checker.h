@@ -0,0 +1,20 @@
+#pragma once
+#include "type_checker.h"
+
+namespace lpg::semantics
+{
+    // Smaller blocks are checked on the calling thread, because handing them to another thread costs more.
+    inline constexpr size_t minimum_parallel_block_size = 1024;
+
+    // Checks the blocks at the top level of input that have at least minimum_block_size nodes on up to thread_count
+    // threads. Such a block only sees the names that are declared in front of it, and its own names end with it, so
+    // it can be checked once the rest of the program has been checked. The result is the same as that of check_types,
+    // and on_error is called with the same errors in the same order, but only after everything has been checked.
+    // Everything is allocated from the default memory_resource.
+    [[nodiscard]] sequence check_types_parallel(syntax::flat_tree const &input, semantic_error_handler const &on_error,
+                                                size_t thread_count, size_t minimum_block_size);
+
+    // Uses one thread per hardware thread and minimum_parallel_block_size.
+    [[nodiscard]] sequence check_types_parallel(syntax::flat_tree const &input,
+                                                semantic_error_handler const &on_error);
+} // namespace lpg::semantics
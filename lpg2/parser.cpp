@@ -1,6 +1,11 @@
 #include "parser.h"
 #include "overloaded.h"
+#include "token_pipe.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <stdexcept>
+#include <thread>
 
 namespace lpg::syntax
 {
@@ -34,8 +39,116 @@ namespace lpg::syntax
 
     namespace
     {
-        template <class T>
-        bool PointeesEqual(const std::unique_ptr<T> &left, const std::unique_ptr<T> &right)
+        // the finalizer of splitmix64
+        [[nodiscard]] constexpr std::uint64_t mix(std::uint64_t value) noexcept
+        {
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9u;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111ebu;
+            return value ^ (value >> 31);
+        }
+
+        [[nodiscard]] constexpr tree_hash combine(tree_hash const seed, std::uint64_t const value) noexcept
+        {
+            return mix(seed ^ (value + 0x9e3779b97f4a7c15u + (seed << 6) + (seed >> 2)));
+        }
+
+        // eight bytes at a time with one multiplication each, because string literals can be long
+        [[nodiscard]] std::uint64_t hash_text(std::string_view const text) noexcept
+        {
+            std::uint64_t result = text.size();
+            size_t i = 0;
+            for (; (i + 8) <= text.size(); i += 8)
+            {
+                std::uint64_t word = 0;
+                std::memcpy(&word, text.data() + i, 8);
+                result = (result ^ word) * 0x9e3779b97f4a7c15u;
+            }
+            std::uint64_t rest = 0;
+            for (size_t shift = 0; i < text.size(); ++i, shift += 8)
+            {
+                rest |= static_cast<std::uint64_t>(static_cast<unsigned char>(text[i])) << shift;
+            }
+            return mix(result ^ rest);
+        }
+
+        // distinguishes the kinds of nodes
+        enum class hash_tag : std::uint64_t
+        {
+            string_literal = 1,
+            identifier,
+            call,
+            sequence,
+            declaration,
+            bool_literal,
+            binary_operator,
+            binary_operator_literal
+        };
+
+        [[nodiscard]] constexpr tree_hash start_hash(hash_tag const tag) noexcept
+        {
+            return mix(static_cast<std::uint64_t>(tag));
+        }
+
+        [[nodiscard]] tree_hash hash_pointee(expression_ptr const &child) noexcept
+        {
+            return child ? child->hash : 0;
+        }
+
+        [[nodiscard]] tree_hash hash_elements(std::pmr::vector<expression> const &elements) noexcept
+        {
+            tree_hash result = start_hash(hash_tag::sequence);
+            for (expression const &element : elements)
+            {
+                result = combine(result, element.hash);
+            }
+            return combine(result, elements.size());
+        }
+
+        void update_expression_hashes(expression &tree)
+        {
+            bool const is_inner = std::visit(
+                overloaded{[](call &call_) {
+                               if (call_.callee)
+                               {
+                                   update_expression_hashes(*call_.callee);
+                               }
+                               for (expression_ptr &argument : call_.arguments)
+                               {
+                                   if (argument)
+                                   {
+                                       update_expression_hashes(*argument);
+                                   }
+                               }
+                               return true;
+                           },
+                           [](sequence &sequence_) {
+                               update_hashes(sequence_);
+                               return true;
+                           },
+                           [](declaration &declaration_) {
+                               if (declaration_.initializer)
+                               {
+                                   update_expression_hashes(*declaration_.initializer);
+                               }
+                               return true;
+                           },
+                           [](binary_operator_expression &binary) {
+                               update_expression_hashes(*binary.left);
+                               update_expression_hashes(*binary.right);
+                               return true;
+                           },
+                           // the hashes of leaves never change
+                           [](auto &) {
+                               return false;
+                           }},
+                tree.value);
+            if (is_inner)
+            {
+                tree.hash = expression::hash_node(tree.value);
+            }
+        }
+
+        bool PointeesEqual(const expression_ptr &left, const expression_ptr &right)
         {
             if (left)
             {
@@ -65,7 +178,7 @@ namespace lpg::syntax
         return PointeesEqual(left.callee, right.callee);
     }
 
-    sequence::sequence(std::vector<expression> elements, source_location location)
+    sequence::sequence(std::pmr::vector<expression> elements, source_location location)
         : elements(move(elements))
         , location(location)
     {
@@ -100,8 +213,9 @@ namespace lpg::syntax
         return out << " = " << *value.initializer;
     }
 
-    identifier::identifier(std::string_view content, source_location location)
+    identifier::identifier(std::string_view content, symbol_id symbol, source_location location)
         : content(content)
+        , symbol(symbol)
         , location(location)
     {
     }
@@ -156,9 +270,64 @@ namespace lpg::syntax
         return out << value.value;
     }
 
+    tree_hash expression::hash_node(variant const &node) noexcept
+    {
+        return std::visit(
+            overloaded{[](string_literal_expression const &string) -> tree_hash {
+                           return combine(start_hash(hash_tag::string_literal),
+                                          hash_text(string.literal.inner_content));
+                       },
+                       [](identifier const &identifier_) -> tree_hash {
+                           return combine(start_hash(hash_tag::identifier), hash_text(identifier_.content));
+                       },
+                       [](call const &call_) -> tree_hash {
+                           tree_hash result = combine(start_hash(hash_tag::call), hash_pointee(call_.callee));
+                           for (expression_ptr const &argument : call_.arguments)
+                           {
+                               result = combine(result, hash_pointee(argument));
+                           }
+                           return combine(result, call_.arguments.size());
+                       },
+                       [](sequence const &sequence_) -> tree_hash {
+                           return hash_elements(sequence_.elements);
+                       },
+                       [](declaration const &declaration_) -> tree_hash {
+                           return combine(combine(start_hash(hash_tag::declaration),
+                                                  hash_text(declaration_.name.content)),
+                                          hash_pointee(declaration_.initializer));
+                       },
+                       [](bool_literal_expression const &boolean) -> tree_hash {
+                           return combine(start_hash(hash_tag::bool_literal), boolean.literal.inner_content);
+                       },
+                       [](binary_operator_expression const &binary) -> tree_hash {
+                           return combine(combine(combine(start_hash(hash_tag::binary_operator),
+                                                          static_cast<std::uint64_t>(binary.which)),
+                                                  hash_pointee(binary.left)),
+                                          hash_pointee(binary.right));
+                       },
+                       [](binary_operator_literal_expression const &literal) -> tree_hash {
+                           return combine(start_hash(hash_tag::binary_operator_literal),
+                                          static_cast<std::uint64_t>(literal.which));
+                       }},
+            node);
+    }
+
     bool operator==(const expression &left, const expression &right) noexcept
     {
-        return left.value == right.value;
+        return (left.hash == right.hash) && (left.value == right.value);
+    }
+
+    tree_hash get_hash(sequence const &tree) noexcept
+    {
+        return hash_elements(tree.elements);
+    }
+
+    void update_hashes(sequence &tree)
+    {
+        for (expression &element : tree.elements)
+        {
+            update_expression_hashes(element);
+        }
     }
 
     source_location get_location(expression const &tree)
@@ -192,47 +361,79 @@ namespace lpg::syntax
             tree.value);
     }
 
-    std::optional<non_comment> peek_next_non_comment(scanner &tokens)
+    namespace
     {
-        for (;;)
+        [[nodiscard]] sequence *find_block_in_last_candidate(std::vector<expression *> const &candidates,
+                                                             source_location const brace,
+                                                             std::vector<expression *> &path)
         {
-            std::optional<token> maybe_peeked = tokens.peek();
-            if (!maybe_peeked)
-            {
-                return std::nullopt;
-            }
-
-            token &peeked = *maybe_peeked;
-            std::optional<non_comment> result = std::visit(
-                overloaded{
-                    [](comment const &) -> std::optional<non_comment> {
-                        return std::nullopt;
-                    },
-                    [&peeked](auto value) -> std::optional<non_comment> {
-                        return non_comment{std::move(value), peeked.location};
-                    },
-                },
-                peeked.content);
-
-            if (result.has_value())
+            // get_location returns the leftmost token of an expression apart from parentheses and let, so a brace
+            // belongs to the last candidate that does not begin behind it
+            for (auto i = candidates.rbegin(); i != candidates.rend(); ++i)
             {
-                return result;
+                if (get_location(**i) <= brace)
+                {
+                    path.emplace_back(*i);
+                    return std::visit(
+                        overloaded{[brace, &path](sequence &block) -> sequence * {
+                                       if (block.location == brace)
+                                       {
+                                           return &block;
+                                       }
+                                       return find_block(block, brace, path);
+                                   },
+                                   [brace, &path](call &call_) -> sequence * {
+                                       std::vector<expression *> children{call_.callee.get()};
+                                       for (expression_ptr const &argument : call_.arguments)
+                                       {
+                                           children.emplace_back(argument.get());
+                                       }
+                                       return find_block_in_last_candidate(children, brace, path);
+                                   },
+                                   [brace, &path](declaration &declaration_) -> sequence * {
+                                       return find_block_in_last_candidate(
+                                           {declaration_.initializer.get()}, brace, path);
+                                   },
+                                   [brace, &path](binary_operator_expression &binary) -> sequence * {
+                                       return find_block_in_last_candidate(
+                                           {binary.left.get(), binary.right.get()}, brace, path);
+                                   },
+                                   [](auto &) -> sequence * {
+                                       return nullptr;
+                                   }},
+                        (*i)->value);
+                }
             }
-            std::optional<token> popped = tokens.pop();
-            assert(popped);
+            return nullptr;
         }
-    }
+    } // namespace
 
-    std::optional<non_comment> pop_next_non_comment(scanner &tokens)
+    sequence *find_block(sequence &tree, source_location const brace, std::vector<expression *> &path)
     {
-        std::optional<non_comment> peeked = peek_next_non_comment(tokens);
-        if (!peeked.has_value())
+        auto const found =
+            std::upper_bound(tree.elements.begin(), tree.elements.end(), brace,
+                             [](source_location const location, expression const &element) {
+                                 return location < get_location(element);
+                             });
+        if (found == tree.elements.begin())
         {
-            return std::nullopt;
+            return nullptr;
         }
-        std::optional<token> popped = tokens.pop();
-        assert(popped);
-        return peeked;
+        return find_block_in_last_candidate({&*(found - 1)}, brace, path);
+    }
+
+    non_comment make_non_comment(token value)
+    {
+        return non_comment{std::visit(overloaded{
+                                          [](comment const &) -> non_comment_content {
+                                              LPG_UNREACHABLE();
+                                          },
+                                          [](auto element) -> non_comment_content {
+                                              return element;
+                                          },
+                                      },
+                                      value.content),
+                           value.location};
     }
 
     parse_error::parse_error(std::string error_message, source_location where)
@@ -251,293 +452,51 @@ namespace lpg::syntax
         return out << value.where << ": " << value.error_message;
     }
 
-    std::tuple<std::optional<identifier_token>, source_location> parser::expect_identifier()
-    {
-        std::optional<token> token = tokens.pop();
-
-        if (!token)
-        {
-            on_error(parse_error{"Expected identifier but got end of stream", tokens.next_location});
-            return std::make_tuple(std::nullopt, tokens.next_location);
-        }
-
-        return std::make_tuple(
-            std::visit(overloaded{
-                           [](identifier_token &&identifier_) -> std::optional<identifier_token> {
-                               return std::move(identifier_);
-                           },
-                           [this, &token](auto &&) -> std::optional<identifier_token> {
-                               on_error(parse_error({"Expected identifier", token->location}));
-                               return std::nullopt;
-                           },
-                       },
-                       std::move(token->content)),
-            token->location);
-    }
-
-    std::optional<declaration> parser::parse_declaration()
+    std::string format(parse_error const &error, line_index &lines)
     {
-        auto [name, location] = expect_identifier();
-        if (!name)
-        {
-            return std::nullopt;
-        }
-
-        const bool is_assignment = expect_special_character(special_character::assign);
-        if (!is_assignment)
-        {
-            return std::nullopt;
-        }
-
-        std::optional<expression> initializer = parse_expression();
-        if (!initializer)
-        {
-            on_error(parse_error{
-                "Invalid initializer value for identifier: " + std::string(name.value().content), location});
-            return std::nullopt;
-        }
-        return declaration{
-            identifier{name->content, location}, std::make_unique<expression>(std::move(initializer.value()))};
+        std::ostringstream result;
+        result << lines.locate(error.where) << ": " << error.error_message;
+        return result.str();
     }
 
-    bool parser::expect_special_character(special_character expected)
+    sequence compile(std::string_view source, std::function<void(parse_error)> on_error)
     {
-        const std::optional<token> token = tokens.pop();
-        if (!token)
-        {
-            on_error(parse_error{"Expected special character but got end of stream", tokens.next_location});
-            return false;
-        }
-        if (std::holds_alternative<special_character>(token->content))
-        {
-            if (expected != std::get<special_character>(token->content))
-            {
-                on_error(parse_error{"Expected a different special character", token->location});
-            }
-            else
-            {
-                return true;
-            }
-        }
-        on_error(parse_error{"Expected something else", token->location});
-        return false;
+        return compile<std::function<void(parse_error)> &>(source, on_error);
     }
 
-    std::optional<expression> parser::parse_expression()
+    sequence compile_pipelined(std::string_view source, std::function<void(parse_error)> on_error)
     {
-        std::optional<non_comment> const next_token = pop_next_non_comment(tokens);
-        if (!next_token)
+        if (source.size() > std::numeric_limits<std::uint32_t>::max())
         {
-            on_error(parse_error{"Unexpected end of stream", tokens.next_location});
-            return std::nullopt;
+            throw std::length_error("The source is too large for 32-bit token offsets");
         }
-
-        std::optional<expression> left_side = std::visit(
-            overloaded{
-                [this, &next_token](identifier_token const &callee) -> std::optional<expression> {
-                    if (callee.content == "let")
-                    {
-                        std::optional<declaration> declaration = parse_declaration();
-                        if (!declaration)
-                        {
-                            return std::nullopt;
-                        }
-                        return expression{std::move(declaration.value())};
-                    }
-                    return expression{identifier{callee.content, next_token->location}};
-                },
-                [this, &next_token](special_character character) -> std::optional<expression> {
-                    switch (character)
-                    {
-                    case special_character::left_parenthesis:
-                        return parse_parentheses();
-                    case special_character::right_parenthesis:
-                        on_error(parse_error({"Can not have a closing parenthesis here.", next_token->location}));
-                        return std::nullopt;
-                    case special_character::left_brace:
-                        return parse_braces(next_token->location);
-                    case special_character::right_brace:
-                        on_error(parse_error({"Can not have a closing parenthesis here.", next_token->location}));
-                        return std::nullopt;
-                    case special_character::slash:
-                        on_error(parse_error({"Can not have a slash here.", next_token->location}));
-                        return std::nullopt;
-                    case special_character::assign:
-                        on_error(parse_error({"Can not have an assignment operator here.", next_token->location}));
-                        return std::nullopt;
-                    case special_character::equals:
-                        return expression{
-                            binary_operator_literal_expression{binary_operator::equals, next_token->location}};
-                    case special_character::comma:
-                        on_error(parse_error({"Can not have a comma operator here.", next_token->location}));
-                        return std::nullopt;
-                    }
-                    LPG_UNREACHABLE();
-                },
-                [&next_token](string_literal const &literal) -> std::optional<expression> {
-                    return expression{string_literal_expression{literal, next_token->location}};
-                },
-                [&next_token](keyword const keyword_) -> std::optional<expression> {
-                    switch (keyword_)
-                    {
-                    case keyword::true_:
-                        return expression{bool_literal_expression{boolean_literal{true}, next_token->location}};
-                    case keyword::false_:
-                        return expression{bool_literal_expression{boolean_literal{false}, next_token->location}};
-                    }
-                    LPG_UNREACHABLE();
-                }},
-            next_token->content);
-
-        std::optional<non_comment> right_side = peek_next_non_comment(tokens);
-        if (!right_side)
+        token_pipe pipe;
+        std::jthread lexer([source, &pipe]() {
+            tokenize_into(source, simd::best_kernels(), pipe);
+        });
+        // The parser may stop before the end of the source or throw, but the lexer must not be left waiting for it.
+        struct cancel_on_exit
         {
-            return left_side;
-        }
-
-        return std::visit(
-            overloaded{[&left_side](identifier_token const &) -> std::optional<expression> {
-                           return std::move(left_side);
-                       },
-                       [this, &left_side, &right_side](special_character character) -> std::optional<expression> {
-                           switch (character)
-                           {
-                           case special_character::left_parenthesis:
-                               return parse_call(std::move(left_side.value()));
-                           case special_character::right_parenthesis:
-                               return std::move(left_side);
-                           case special_character::left_brace:
-                               return std::move(left_side);
-                           case special_character::right_brace:
-                               return std::move(left_side);
-                           case special_character::slash:
-                               on_error(parse_error{"Can not have a slash here.", right_side->location});
-                               return std::nullopt;
-                           case special_character::assign:
-                               on_error(parse_error{"Can not have an assignment operator here.", right_side->location});
-                               return std::nullopt;
-                           case special_character::equals: {
-                               // pop the operator
-                               (void)tokens.pop();
-                               std::optional<expression> right_argument = parse_expression();
-                               if (!right_argument)
-                               {
-                                   on_error(parse_error{
-                                       "Binary operator requires a right-hand side argument", right_side->location});
-                                   return std::move(left_side);
-                               }
-                               return expression{binary_operator_expression{
-                                   binary_operator::equals, std::make_unique<expression>(std::move(*left_side)),
-                                   std::make_unique<expression>(std::move(*right_argument))}};
-                           }
-                           case special_character::comma:
-                               return std::move(left_side);
-                           }
-                           LPG_UNREACHABLE();
-                       },
-                       [&left_side](string_literal const &) -> std::optional<expression> {
-                           return std::move(left_side);
-                       },
-                       [&left_side](keyword const) -> std::optional<expression> {
-                           return std::move(left_side);
-                       }},
-            right_side->content);
-    }
+            token_pipe &pipe;
 
-    sequence parser::parse_sequence(const bool is_in_braces, source_location const &start_location)
-    {
-        sequence result{{}, start_location};
-        for (;;)
-        {
-            std::optional<non_comment> maybe_token = peek_next_non_comment(tokens);
-            if (!maybe_token)
+            ~cancel_on_exit()
             {
-                if (is_in_braces)
-                {
-                    on_error(parse_error{"Missing closing brace '}' before end of file", tokens.next_location});
-                }
-                break;
+                pipe.cancel();
             }
-            if (is_in_braces)
-            {
-                special_character const *const token = std::get_if<special_character>(&maybe_token->content);
-                if (token && (*token == special_character::right_brace))
-                {
-                    (void)tokens.pop();
-                    break;
-                }
-            }
-            std::optional<expression> expression = parse_expression();
-            if (!expression)
-            {
-                break;
-            }
-            result.elements.push_back(std::move(expression.value()));
-        }
-        return result;
-    }
-
-    std::optional<expression> parser::parse_parentheses()
-    {
-        std::optional<expression> result = parse_expression();
-        if (!result)
-        {
-            return std::nullopt;
-        }
-        expect_special_character(special_character::right_parenthesis);
-        return result;
-    }
-
-    std::optional<expression> parser::parse_braces(source_location const &start_location)
-    {
-        return expression{parse_sequence(true, start_location)};
-    }
-
-    std::optional<expression> parser::parse_call(expression callee)
-    {
-        // popping off the left parenthesis
-        token const parenthesis = tokens.pop().value();
-        std::vector<std::unique_ptr<expression>> arguments;
-        for (;;)
+        } const cancel{pipe};
+        parser<std::function<void(parse_error)> &> parser(token_cursor{source, pipe}, on_error);
+        sequence parsed = parser.parse_sequence(false, source_location{0});
+        if (parser.tokens.has_failed)
         {
-            {
-                std::optional<non_comment> maybe_next = peek_next_non_comment(tokens);
-                if (!maybe_next)
-                {
-                    on_error(parse_error{"Could not parse arguments of the function", parenthesis.location});
-                    return std::nullopt;
-                }
-                special_character const *const token = std::get_if<special_character>(&maybe_next->content);
-                if (token && (*token == special_character::right_parenthesis))
-                {
-                    (void)tokens.pop();
-                    return expression{call{std::make_unique<expression>(std::move(callee)), std::move(arguments)}};
-                }
-            }
-            if (!arguments.empty() && !expect_special_character(special_character::comma))
-            {
-                return std::nullopt;
-            }
-            {
-                std::optional<expression> argument = parse_expression();
-                if (!argument)
-                {
-                    on_error(parse_error{"Could not parse argument of the function", parenthesis.location});
-                    return std::nullopt;
-                }
-                arguments.emplace_back(std::make_unique<expression>(std::move(*argument)));
-            }
+            parser.report(message_id::tokenization_failed, parser.tokens.next_location);
         }
+        return parsed;
     }
 
-    sequence compile(std::string_view source, std::function<void(parse_error)> on_error)
+    compiled_file compile_file(std::filesystem::path const &path, std::function<void(parse_error)> on_error)
     {
-        parser parser(scanner{source}, on_error);
-        sequence parsed = parser.parse_sequence(false, source_location{0, 0});
-        if (parser.tokens.has_failed)
-        {
-            on_error(parse_error{"Tokenization failed", parser.tokens.next_location});
-        }
-        return parsed;
+        source_file source(path);
+        sequence parsed = compile(source.content(), std::move(on_error));
+        return compiled_file{std::move(source), std::move(parsed)};
     }
 } // namespace lpg::syntax
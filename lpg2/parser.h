@@ -1,7 +1,14 @@
 #pragma once
-#include "tokenizer.h"
+#include "brace_index.h"
+#include "diagnostics.h"
+#include "error_sink.h"
+#include "overloaded.h"
+#include "source_file.h"
+#include "token_buffer.h"
+#include <array>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <variant>
 #include <vector>
@@ -19,12 +26,33 @@ namespace lpg::syntax
     std::ostream &operator<<(std::ostream &out, const non_comment &value);
     bool operator==(const non_comment &left, const non_comment &right) noexcept;
 
+    // value must not be a comment.
+    [[nodiscard]] non_comment make_non_comment(token value);
+
     struct expression;
 
+    // Destroys an expression and gives its memory back to the resource that it was allocated from.
+    struct expression_deleter
+    {
+        std::pmr::memory_resource *resource;
+
+        void operator()(expression *doomed) const noexcept;
+    };
+
+    // How nodes own their children. The parser allocates all nodes and lists of a tree from one memory_resource, so a
+    // tree can live in an arena that is released at once.
+    using expression_ptr = std::unique_ptr<expression, expression_deleter>;
+
+    // The structure and the contents of a tree in 64 bits, without its locations and symbol ids. Equal trees have equal
+    // hashes, so trees with different hashes differ without being compared, and a hash can be the key of a cache of
+    // results per subtree, even across compiles. Each expression stores its hash, which is combined from those of
+    // its children when it is constructed.
+    using tree_hash = std::uint64_t;
+
     struct call
     {
-        std::unique_ptr<expression> callee;
-        std::vector<std::unique_ptr<expression>> arguments;
+        expression_ptr callee;
+        std::pmr::vector<expression_ptr> arguments;
     };
 
     std::ostream &operator<<(std::ostream &out, const call &value);
@@ -32,10 +60,10 @@ namespace lpg::syntax
 
     struct sequence
     {
-        std::vector<expression> elements;
+        std::pmr::vector<expression> elements;
         source_location location;
 
-        sequence(std::vector<expression> elements, source_location location);
+        sequence(std::pmr::vector<expression> elements, source_location location);
     };
 
     std::ostream &operator<<(std::ostream &out, const sequence &value);
@@ -44,9 +72,10 @@ namespace lpg::syntax
     struct identifier
     {
         std::string_view content;
+        symbol_id symbol;
         source_location location;
 
-        identifier(std::string_view content, source_location location);
+        identifier(std::string_view content, symbol_id symbol, source_location location);
         std::weak_ordering operator<=>(identifier const &other) const noexcept = default;
     };
 
@@ -55,7 +84,7 @@ namespace lpg::syntax
     struct declaration
     {
         identifier name;
-        std::unique_ptr<expression> initializer;
+        expression_ptr initializer;
     };
 
     std::ostream &operator<<(std::ostream &out, const declaration &value);
@@ -88,11 +117,52 @@ namespace lpg::syntax
 
     std::ostream &operator<<(std::ostream &out, binary_operator value);
 
+    // How a binary_operator is spelled and how it binds. The parser knows binary operators only from this table, so a
+    // new operator needs an entry here, not a new code path.
+    struct binary_operator_info
+    {
+        special_character token;
+        binary_operator which;
+        // An operator with a higher precedence binds more tightly.
+        std::uint8_t precedence;
+        // a == b == c is (a == b) == c if false, and a == (b == c) if true.
+        bool is_right_associative;
+    };
+
+    inline constexpr std::array<binary_operator_info, 1> binary_operators = {{
+        {special_character::equals, binary_operator::equals, 1, false},
+    }};
+
+    // Returns nullptr if token is not a binary operator.
+    [[nodiscard]] constexpr binary_operator_info const *find_binary_operator(special_character const token) noexcept
+    {
+        for (binary_operator_info const &entry : binary_operators)
+        {
+            if (entry.token == token)
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] constexpr binary_operator_info const &get_binary_operator_info(binary_operator const which) noexcept
+    {
+        for (binary_operator_info const &entry : binary_operators)
+        {
+            if (entry.which == which)
+            {
+                return entry;
+            }
+        }
+        LPG_UNREACHABLE();
+    }
+
     struct binary_operator_expression
     {
         binary_operator which;
-        std::unique_ptr<expression> left;
-        std::unique_ptr<expression> right;
+        expression_ptr left;
+        expression_ptr right;
     };
 
     std::ostream &operator<<(std::ostream &out, const binary_operator_expression &value);
@@ -110,17 +180,52 @@ namespace lpg::syntax
 
     struct expression
     {
-        std::variant<string_literal_expression, identifier, call, sequence, declaration, bool_literal_expression,
-                     binary_operator_expression, binary_operator_literal_expression>
-            value;
+        using variant = std::variant<string_literal_expression, identifier, call, sequence, declaration,
+                                     bool_literal_expression, binary_operator_expression,
+                                     binary_operator_literal_expression>;
+
+        variant value;
+        // out of date when a subtree is replaced, until update_hashes is called
+        tree_hash hash;
+
+        template <class Node>
+            requires(!std::is_same_v<std::remove_cvref_t<Node>, expression>)
+        explicit expression(Node &&node)
+            : value(std::forward<Node>(node))
+            , hash(hash_node(value))
+        {
+        }
+
+        // combines the hashes stored in the children of node
+        [[nodiscard]] static tree_hash hash_node(variant const &node) noexcept;
     };
 
+    inline void expression_deleter::operator()(expression *const doomed) const noexcept
+    {
+        std::pmr::polymorphic_allocator<expression>(resource).delete_object(doomed);
+    }
+
+    [[nodiscard]] inline expression_ptr make_expression(expression value, std::pmr::memory_resource *const resource)
+    {
+        return expression_ptr(
+            std::pmr::polymorphic_allocator<expression>(resource).new_object<expression>(std::move(value)),
+            expression_deleter{resource});
+    }
+
     std::ostream &operator<<(std::ostream &out, const expression &value);
     bool operator==(const expression &left, const expression &right) noexcept;
     [[nodiscard]] source_location get_location(expression const &tree);
 
-    std::optional<non_comment> peek_next_non_comment(scanner &tokens);
-    std::optional<non_comment> pop_next_non_comment(scanner &tokens);
+    // Finds the brace block in tree whose left brace is at brace. The expressions from the top level down to the one
+    // that holds the block are appended to path, which are those whose hashes depend on the block.
+    [[nodiscard]] sequence *find_block(sequence &tree, source_location brace, std::vector<expression *> &path);
+
+    // A sequence does not store a hash, because only the top level is not an expression. This combines the hashes of
+    // the elements.
+    [[nodiscard]] tree_hash get_hash(sequence const &tree) noexcept;
+
+    // Computes the hashes of the inner nodes of tree again, which is necessary after a subtree has been replaced.
+    void update_hashes(sequence &tree);
 
     struct parse_error
     {
@@ -132,29 +237,615 @@ namespace lpg::syntax
 
     bool operator==(const parse_error &left, const parse_error &right) noexcept;
     std::ostream &operator<<(std::ostream &out, const parse_error &value);
+    // Like operator<<, but with the line and the column of the error instead of its offset.
+    [[nodiscard]] std::string format(parse_error const &error, line_index &lines);
+
+    // How deeply the parser nests blocks, calls, parentheses, declarations and binary operators by default.
+    // Deeper trees would overflow the native stack in the recursive functions that process them later.
+    inline constexpr size_t default_max_depth = 10'000;
 
+    // A brace block that the parser left empty.
+    struct skipped_block
+    {
+        // the token of the left brace
+        std::uint32_t left_brace;
+        // how many frames were on the parse stack, because they count towards max_depth when the block is parsed
+        std::uint32_t depth;
+    };
+
+    // ErrorSink is called with every parse_error. It may be a reference.
+    template <class ErrorSink>
     struct parser
     {
-        parser(scanner tokens, std::function<void(parse_error)> on_error)
+        parser(token_cursor tokens, ErrorSink on_error)
             : tokens(std::move(tokens))
-            , on_error(std::move(on_error))
+            , on_error(std::forward<ErrorSink>(on_error))
         {
         }
-        scanner tokens;
-        std::function<void(parse_error)> on_error;
-
+        token_cursor tokens;
+        ErrorSink on_error;
+        // When a program nests deeper than this, parse_sequence reports an error and stops.
+        size_t max_depth = default_max_depth;
+        // When set, the blocks whose braces match according to it are left empty instead of parsed, and are listed in
+        // skipped_blocks. It has to index the token_buffer that is read, which can not come from a token_pipe.
+        brace_index const *braces = nullptr;
+        std::vector<skipped_block> skipped_blocks;
+        // where the tree is allocated
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+
+        // Keeps the unfinished parts of the tree on a heap-allocated stack instead of recursing, so deep nesting can
+        // not overflow the native stack. The stack holds at most max_depth frames.
         sequence parse_sequence(bool is_in_braces, source_location const &start_location);
 
+        // Passes an error to on_error: only the message id and argument if on_error collects_diagnostics, an empty
+        // message if it ignores messages, and the message followed by argument otherwise.
+        void report(message_id message, source_location where, std::string_view argument = {});
+
+        // Whether on_error wants no more errors, so that parsing can stop early.
+        [[nodiscard]] bool has_enough_errors() const;
+
     private:
-        std::optional<expression> parse_expression();
-        std::optional<expression> parse_parentheses();
-        std::optional<expression> parse_braces(source_location const &start_location);
-        std::optional<expression> parse_call(expression callee);
-        std::optional<declaration> parse_declaration();
+        // The next token once it has been peeked. Every decision of the parser depends on the next token only.
+        // Comments are skipped in the token_buffer and never get here.
+        std::optional<non_comment> lookahead;
+
+        // Returns the next non-comment token, or nullptr if there is none. The token stays valid until the next pop.
+        [[nodiscard]] non_comment const *peek();
+        std::optional<non_comment> pop();
 
         std::tuple<std::optional<identifier_token>, source_location> expect_identifier();
         bool expect_special_character(special_character special_character);
+
+        // The unfinished constructs, each waiting for the expression that comes next.
+        struct sequence_frame
+        {
+            sequence result;
+            bool is_in_braces;
+        };
+
+        struct call_frame
+        {
+            expression callee;
+            std::pmr::vector<expression_ptr> arguments;
+            source_location parenthesis;
+        };
+
+        struct parentheses_frame
+        {
+        };
+
+        struct declaration_frame
+        {
+            identifier name;
+        };
+
+        struct binary_operator_frame
+        {
+            expression left;
+            binary_operator_info const *operator_;
+            source_location operator_location;
+            // How many binary operators have been folded into left. A chain is as deep as it is long, so this counts
+            // towards max_depth.
+            size_t chain_length;
+        };
+
+        using frame =
+            std::variant<sequence_frame, call_frame, parentheses_frame, declaration_frame, binary_operator_frame>;
     };
 
+    template <class ErrorSink>
+    void parser<ErrorSink>::report(message_id const message, source_location const where,
+                                   std::string_view const argument)
+    {
+        if constexpr (collects_diagnostics<ErrorSink>)
+        {
+            on_error.add(message, where, argument);
+        }
+        else if constexpr (ignores_error_messages<ErrorSink>)
+        {
+            on_error(parse_error{std::string(), where});
+        }
+        else
+        {
+            std::string_view const text = get_message(message);
+            std::string full_message;
+            full_message.reserve(text.size() + argument.size());
+            full_message += text;
+            full_message += argument;
+            on_error(parse_error{std::move(full_message), where});
+        }
+    }
+
+    template <class ErrorSink>
+    bool parser<ErrorSink>::has_enough_errors() const
+    {
+        if constexpr (collects_diagnostics<ErrorSink>)
+        {
+            return on_error.is_full();
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    template <class ErrorSink>
+    non_comment const *parser<ErrorSink>::peek()
+    {
+        if (!lookahead)
+        {
+            tokens.skip_comments();
+            std::optional<token> next = tokens.pop();
+            if (!next)
+            {
+                return nullptr;
+            }
+            lookahead = make_non_comment(std::move(*next));
+        }
+        return &*lookahead;
+    }
+
+    template <class ErrorSink>
+    std::optional<non_comment> parser<ErrorSink>::pop()
+    {
+        if (!peek())
+        {
+            return std::nullopt;
+        }
+        std::optional<non_comment> result = std::move(lookahead);
+        lookahead.reset();
+        return result;
+    }
+
+    template <class ErrorSink>
+    std::tuple<std::optional<identifier_token>, source_location> parser<ErrorSink>::expect_identifier()
+    {
+        std::optional<non_comment> token = pop();
+
+        if (!token)
+        {
+            report(message_id::expected_identifier_at_end, tokens.next_location);
+            return std::make_tuple(std::nullopt, tokens.next_location);
+        }
+
+        return std::make_tuple(
+            std::visit(overloaded{
+                           [](identifier_token &&identifier_) -> std::optional<identifier_token> {
+                               return std::move(identifier_);
+                           },
+                           [this, &token](auto &&) -> std::optional<identifier_token> {
+                               report(message_id::expected_identifier, token->location);
+                               return std::nullopt;
+                           },
+                       },
+                       std::move(token->content)),
+            token->location);
+    }
+
+    template <class ErrorSink>
+    bool parser<ErrorSink>::expect_special_character(special_character expected)
+    {
+        std::optional<non_comment> const token = pop();
+        if (!token)
+        {
+            report(message_id::expected_special_character_at_end, tokens.next_location);
+            return false;
+        }
+        if (std::holds_alternative<special_character>(token->content))
+        {
+            if (expected != std::get<special_character>(token->content))
+            {
+                report(message_id::expected_different_special_character, token->location);
+            }
+            else
+            {
+                return true;
+            }
+        }
+        report(message_id::expected_something_else, token->location);
+        return false;
+    }
+
+    template <class ErrorSink>
+    sequence parser<ErrorSink>::parse_sequence(const bool is_in_braces, source_location const &start_location)
+    {
+        enum class step
+        {
+            // look at the next token of the sequence on top of the stack
+            continue_sequence,
+            // look at the next token of the call on top of the stack
+            continue_call,
+            // parse an expression up to where a call or a binary operator may follow
+            begin_expression,
+            // value is the left side of an expression, continue it if it is followed by a call or a binary operator
+            after_left_side,
+            // value is a whole expression, or nullopt after an error, for the frame on top of the stack
+            deliver
+        };
+
+        std::vector<frame> stack;
+        stack.emplace_back(
+            sequence_frame{sequence{std::pmr::vector<expression>(resource), start_location}, is_in_braces});
+        step next = step::continue_sequence;
+        std::optional<expression> value;
+
+        auto const push = [this, &stack](frame pushed, source_location const where,
+                                         size_t const extra_depth = 0) -> bool {
+            if ((stack.size() + extra_depth) >= max_depth)
+            {
+                report(message_id::nesting_too_deep, where);
+                return false;
+            }
+            stack.emplace_back(std::move(pushed));
+            return true;
+        };
+
+        // Gives up on the whole program and returns what has been parsed at the outermost level.
+        auto const give_up = [&stack]() -> sequence {
+            return std::move(std::get<sequence_frame>(stack.front()).result);
+        };
+
+        auto const fold = [this](binary_operator_frame &left, expression right) -> expression {
+            return expression{binary_operator_expression{left.operator_->which,
+                                                         make_expression(std::move(left.left), resource),
+                                                         make_expression(std::move(right), resource)}};
+        };
+
+        // Returns true when the outermost sequence is complete.
+        auto const finish_sequence = [&stack, &value, &next]() -> bool {
+            if (stack.size() == 1)
+            {
+                return true;
+            }
+            value = expression{std::move(std::get<sequence_frame>(stack.back()).result)};
+            stack.pop_back();
+            next = step::after_left_side;
+            return false;
+        };
+
+        for (;;)
+        {
+            switch (next)
+            {
+            case step::continue_sequence: {
+                sequence_frame &top = std::get<sequence_frame>(stack.back());
+                non_comment const *const token = peek();
+                if (token)
+                {
+                    special_character const *const character = std::get_if<special_character>(&token->content);
+                    if (!top.is_in_braces || !character || (*character != special_character::right_brace))
+                    {
+                        next = step::begin_expression;
+                        break;
+                    }
+                    (void)pop();
+                }
+                else if (top.is_in_braces)
+                {
+                    report(message_id::missing_closing_brace, tokens.next_location);
+                }
+                if (finish_sequence())
+                {
+                    return give_up();
+                }
+                break;
+            }
+
+            case step::continue_call: {
+                call_frame &top = std::get<call_frame>(stack.back());
+                next = step::deliver;
+                non_comment const *const token = peek();
+                if (!token)
+                {
+                    report(message_id::could_not_parse_arguments, top.parenthesis);
+                    value = std::nullopt;
+                    stack.pop_back();
+                    break;
+                }
+                special_character const *const character = std::get_if<special_character>(&token->content);
+                if (character && (*character == special_character::right_parenthesis))
+                {
+                    (void)pop();
+                    value =
+                        expression{call{make_expression(std::move(top.callee), resource), std::move(top.arguments)}};
+                    stack.pop_back();
+                    break;
+                }
+                if (!top.arguments.empty() && !expect_special_character(special_character::comma))
+                {
+                    value = std::nullopt;
+                    stack.pop_back();
+                    break;
+                }
+                next = step::begin_expression;
+                break;
+            }
+
+            case step::begin_expression: {
+                if (has_enough_errors())
+                {
+                    return give_up();
+                }
+                value = std::nullopt;
+                std::optional<non_comment> const token = pop();
+                if (!token)
+                {
+                    report(message_id::unexpected_end_of_stream, tokens.next_location);
+                    next = step::deliver;
+                    break;
+                }
+                next = step::after_left_side;
+                source_location const location = token->location;
+                if (identifier_token const *const name = std::get_if<identifier_token>(&token->content))
+                {
+                    value = expression{identifier{name->content, name->symbol, location}};
+                }
+                else if (string_literal const *const literal = std::get_if<string_literal>(&token->content))
+                {
+                    value = expression{string_literal_expression{*literal, location}};
+                }
+                else if (keyword const *const keyword_ = std::get_if<keyword>(&token->content))
+                {
+                    switch (*keyword_)
+                    {
+                    case keyword::true_:
+                        value = expression{bool_literal_expression{boolean_literal{true}, location}};
+                        break;
+                    case keyword::false_:
+                        value = expression{bool_literal_expression{boolean_literal{false}, location}};
+                        break;
+                    case keyword::let_: {
+                        auto [name, name_location] = expect_identifier();
+                        if (!name || !expect_special_character(special_character::assign))
+                        {
+                            break;
+                        }
+                        if (!push(declaration_frame{identifier{name->content, name->symbol, name_location}}, location))
+                        {
+                            return give_up();
+                        }
+                        next = step::begin_expression;
+                        break;
+                    }
+                    }
+                }
+                else
+                {
+                    switch (std::get<special_character>(token->content))
+                    {
+                    case special_character::left_parenthesis:
+                        if (!push(parentheses_frame{}, location))
+                        {
+                            return give_up();
+                        }
+                        next = step::begin_expression;
+                        break;
+                    case special_character::right_parenthesis:
+                        report(message_id::closing_parenthesis_here, location);
+                        break;
+                    case special_character::left_brace:
+                        if (braces && (stack.size() < max_depth))
+                        {
+                            // only the brace itself has been peeked
+                            assert(!lookahead);
+                            size_t const left_brace = tokens.next_token - 1;
+                            std::uint32_t const right_brace = braces->matching[left_brace];
+                            if (right_brace != brace_index::unmatched)
+                            {
+                                skipped_blocks.emplace_back(skipped_block{static_cast<std::uint32_t>(left_brace),
+                                                                          static_cast<std::uint32_t>(stack.size())});
+                                tokens.next_token = right_brace + 1;
+                                tokens.next_location = source_location{tokens.tokens.offsets[right_brace] + 1};
+                                value = expression{sequence{std::pmr::vector<expression>(resource), location}};
+                                break;
+                            }
+                        }
+                        if (!push(sequence_frame{sequence{std::pmr::vector<expression>(resource), location}, true},
+                                  location))
+                        {
+                            return give_up();
+                        }
+                        next = step::continue_sequence;
+                        break;
+                    case special_character::right_brace:
+                        report(message_id::closing_parenthesis_here, location);
+                        break;
+                    case special_character::slash:
+                        report(message_id::slash_here, location);
+                        break;
+                    case special_character::assign:
+                        report(message_id::assignment_operator_here, location);
+                        break;
+                    case special_character::equals:
+                        value = expression{binary_operator_literal_expression{binary_operator::equals, location}};
+                        break;
+                    case special_character::comma:
+                        report(message_id::comma_here, location);
+                        break;
+                    }
+                }
+                break;
+            }
+
+            case step::after_left_side: {
+                next = step::deliver;
+                non_comment const *const right_side = peek();
+                special_character const *const character =
+                    right_side ? std::get_if<special_character>(&right_side->content) : nullptr;
+                if (!character)
+                {
+                    break;
+                }
+                source_location const right_location = right_side->location;
+                if (binary_operator_info const *const operator_ = find_binary_operator(*character))
+                {
+                    if (!value)
+                    {
+                        break;
+                    }
+                    // pop the operator
+                    (void)pop();
+                    // Precedence climbing: the operators on the stack that bind at least as tightly take value as their
+                    // right side, so that a chain of left-associative operators needs only one frame.
+                    size_t chain_length = 0;
+                    for (;;)
+                    {
+                        binary_operator_frame *const previous = std::get_if<binary_operator_frame>(&stack.back());
+                        if (!previous || (previous->operator_->precedence < operator_->precedence) ||
+                            ((previous->operator_->precedence == operator_->precedence) &&
+                             operator_->is_right_associative))
+                        {
+                            break;
+                        }
+                        value = fold(*previous, std::move(*value));
+                        chain_length = previous->chain_length + 1;
+                        stack.pop_back();
+                    }
+                    if (!push(binary_operator_frame{std::move(*value), operator_, right_location, chain_length},
+                              right_location, chain_length))
+                    {
+                        return give_up();
+                    }
+                    next = step::begin_expression;
+                    break;
+                }
+                switch (*character)
+                {
+                case special_character::left_parenthesis:
+                    if (!value)
+                    {
+                        break;
+                    }
+                    // pop the parenthesis
+                    (void)pop();
+                    if (!push(call_frame{std::move(*value), std::pmr::vector<expression_ptr>(resource), right_location},
+                              right_location))
+                    {
+                        return give_up();
+                    }
+                    next = step::continue_call;
+                    break;
+                case special_character::right_parenthesis:
+                case special_character::left_brace:
+                case special_character::right_brace:
+                case special_character::comma:
+                    break;
+                case special_character::slash:
+                    report(message_id::slash_here, right_location);
+                    value = std::nullopt;
+                    break;
+                case special_character::assign:
+                    report(message_id::assignment_operator_here, right_location);
+                    value = std::nullopt;
+                    break;
+                case special_character::equals:
+                    // binary operators are handled above
+                    LPG_UNREACHABLE();
+                }
+                break;
+            }
+
+            case step::deliver:
+                if (sequence_frame *const sequence_ = std::get_if<sequence_frame>(&stack.back()))
+                {
+                    if (!value)
+                    {
+                        if (finish_sequence())
+                        {
+                            return give_up();
+                        }
+                        break;
+                    }
+                    sequence_->result.elements.push_back(std::move(*value));
+                    next = step::continue_sequence;
+                }
+                else if (call_frame *const call_ = std::get_if<call_frame>(&stack.back()))
+                {
+                    if (!value)
+                    {
+                        report(message_id::could_not_parse_argument, call_->parenthesis);
+                        stack.pop_back();
+                        break;
+                    }
+                    call_->arguments.emplace_back(make_expression(std::move(*value), resource));
+                    next = step::continue_call;
+                }
+                else if (std::holds_alternative<parentheses_frame>(stack.back()))
+                {
+                    stack.pop_back();
+                    if (value)
+                    {
+                        expect_special_character(special_character::right_parenthesis);
+                    }
+                    next = step::after_left_side;
+                }
+                else if (declaration_frame *const declaration_ = std::get_if<declaration_frame>(&stack.back()))
+                {
+                    if (value)
+                    {
+                        value = expression{declaration{std::move(declaration_->name),
+                                                       make_expression(std::move(*value), resource)}};
+                    }
+                    else
+                    {
+                        report(message_id::invalid_initializer, declaration_->name.location,
+                               declaration_->name.content);
+                    }
+                    stack.pop_back();
+                    next = step::after_left_side;
+                }
+                else
+                {
+                    binary_operator_frame &binary_operator_ = std::get<binary_operator_frame>(stack.back());
+                    if (value)
+                    {
+                        value = fold(binary_operator_, std::move(*value));
+                    }
+                    else
+                    {
+                        report(message_id::missing_right_hand_side,
+                               binary_operator_.operator_location);
+                        value = std::move(binary_operator_.left);
+                    }
+                    stack.pop_back();
+                }
+                break;
+            }
+        }
+    }
+
+    // The tree is allocated from resource, which has to outlive it.
+    template <class ErrorSink>
+    [[nodiscard]] sequence compile(std::string_view source, ErrorSink &&on_error,
+                                   size_t const max_depth = default_max_depth,
+                                   std::pmr::memory_resource *const resource = std::pmr::get_default_resource())
+    {
+        parser<ErrorSink &> parser(token_cursor{source}, on_error);
+        parser.max_depth = max_depth;
+        parser.resource = resource;
+        sequence parsed = parser.parse_sequence(false, source_location{0});
+        if (parser.tokens.has_failed)
+        {
+            parser.report(message_id::tokenization_failed, parser.tokens.next_location);
+        }
+        return parsed;
+    }
+
+    // The type-erased version of the template above.
     [[nodiscard]] sequence compile(std::string_view source, std::function<void(parse_error)> on_error);
+
+    // Like compile, but lexes on another thread while parsing, so that the two overlap on large sources. The tokens
+    // are passed through a token_pipe. Throws std::length_error like tokenize_all.
+    [[nodiscard]] sequence compile_pipelined(std::string_view source, std::function<void(parse_error)> on_error);
+
+    // A syntax tree together with the source file it points into.
+    struct compiled_file
+    {
+        source_file source;
+        sequence parsed;
+    };
+
+    // Maps the file into memory and parses it without copying. Throws like the constructor of source_file.
+    [[nodiscard]] compiled_file compile_file(std::filesystem::path const &path,
+                                             std::function<void(parse_error)> on_error);
 } // namespace lpg::syntax
@@ -0,0 +1,565 @@
+#include "simd.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LPG_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LPG_TARGET_AVX2
+#else
+#define LPG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define LPG_SIMD_X86 0
+#endif
+
+namespace lpg::simd
+{
+    namespace
+    {
+        char const *find_quote_scalar(char const *begin, char const *const end)
+        {
+            while ((begin != end) && (*begin != '"'))
+            {
+                ++begin;
+            }
+            return begin;
+        }
+
+        char const *find_new_line_scalar(char const *begin, char const *const end)
+        {
+            while ((begin != end) && (*begin != '\n'))
+            {
+                ++begin;
+            }
+            return begin;
+        }
+
+        char const *skip_whitespace_scalar(char const *begin, char const *const end)
+        {
+            while ((begin != end) && ((*begin == ' ') || (*begin == '\n')))
+            {
+                ++begin;
+            }
+            return begin;
+        }
+
+        size_t count_new_lines_scalar(char const *begin, char const *const end)
+        {
+            size_t count = 0;
+            for (; begin != end; ++begin)
+            {
+                count += (*begin == '\n');
+            }
+            return count;
+        }
+
+        // Returns one past the sequence that begins with the non-ASCII byte at begin, or nullptr if it is not UTF-8.
+        char const *skip_multi_byte_sequence(char const *const begin, char const *const end) noexcept
+        {
+            auto const byte = [begin](std::ptrdiff_t const index) {
+                return static_cast<unsigned char>(begin[index]);
+            };
+            unsigned char const lead = byte(0);
+            std::ptrdiff_t length = 0;
+            // the second byte is restricted further to rule out overlong encodings, surrogates and code points above
+            // U+10FFFF
+            unsigned char second_minimum = 0x80;
+            unsigned char second_maximum = 0xbf;
+            if ((lead >= 0xc2) && (lead <= 0xdf))
+            {
+                length = 2;
+            }
+            else if ((lead >= 0xe0) && (lead <= 0xef))
+            {
+                length = 3;
+                second_minimum = (lead == 0xe0) ? 0xa0 : 0x80;
+                second_maximum = (lead == 0xed) ? 0x9f : 0xbf;
+            }
+            else if ((lead >= 0xf0) && (lead <= 0xf4))
+            {
+                length = 4;
+                second_minimum = (lead == 0xf0) ? 0x90 : 0x80;
+                second_maximum = (lead == 0xf4) ? 0x8f : 0xbf;
+            }
+            else
+            {
+                return nullptr;
+            }
+            if ((end - begin) < length)
+            {
+                return nullptr;
+            }
+            if ((byte(1) < second_minimum) || (byte(1) > second_maximum))
+            {
+                return nullptr;
+            }
+            for (std::ptrdiff_t i = 2; i < length; ++i)
+            {
+                if ((byte(i) & 0xc0) != 0x80)
+                {
+                    return nullptr;
+                }
+            }
+            return begin + length;
+        }
+
+        char const *find_invalid_utf8_scalar(char const *begin, char const *const end)
+        {
+            while (begin != end)
+            {
+                if (static_cast<unsigned char>(*begin) < 0x80)
+                {
+                    ++begin;
+                    continue;
+                }
+                char const *const next = skip_multi_byte_sequence(begin, end);
+                if (!next)
+                {
+                    return begin;
+                }
+                begin = next;
+            }
+            return begin;
+        }
+
+        char const *find_either_scalar(char const *begin, char const *const end, char const first, char const second)
+        {
+            while ((begin != end) && (*begin != first) && (*begin != second))
+            {
+                ++begin;
+            }
+            return begin;
+        }
+
+#if LPG_SIMD_X86
+        char const *find_byte_sse2(char const *begin, char const *const end, char const needle)
+        {
+            __m128i const pattern = _mm_set1_epi8(needle);
+            while ((end - begin) >= 16)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(begin));
+                unsigned const mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern)));
+                if (mask != 0)
+                {
+                    return begin + std::countr_zero(mask);
+                }
+                begin += 16;
+            }
+            while ((begin != end) && (*begin != needle))
+            {
+                ++begin;
+            }
+            return begin;
+        }
+
+        char const *find_either_sse2(char const *begin, char const *const end, char const first, char const second)
+        {
+            __m128i const first_pattern = _mm_set1_epi8(first);
+            __m128i const second_pattern = _mm_set1_epi8(second);
+            while ((end - begin) >= 16)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(begin));
+                __m128i const is_either =
+                    _mm_or_si128(_mm_cmpeq_epi8(block, first_pattern), _mm_cmpeq_epi8(block, second_pattern));
+                unsigned const mask = static_cast<unsigned>(_mm_movemask_epi8(is_either));
+                if (mask != 0)
+                {
+                    return begin + std::countr_zero(mask);
+                }
+                begin += 16;
+            }
+            return find_either_scalar(begin, end, first, second);
+        }
+
+        char const *find_quote_sse2(char const *begin, char const *const end)
+        {
+            return find_byte_sse2(begin, end, '"');
+        }
+
+        char const *find_new_line_sse2(char const *begin, char const *const end)
+        {
+            return find_byte_sse2(begin, end, '\n');
+        }
+
+        char const *skip_whitespace_sse2(char const *begin, char const *const end)
+        {
+            __m128i const space = _mm_set1_epi8(' ');
+            __m128i const new_line = _mm_set1_epi8('\n');
+            while ((end - begin) >= 16)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(begin));
+                __m128i const is_whitespace =
+                    _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, new_line));
+                unsigned const non_whitespace = static_cast<unsigned>(_mm_movemask_epi8(is_whitespace)) ^ 0xffffu;
+                if (non_whitespace != 0)
+                {
+                    return begin + std::countr_zero(non_whitespace);
+                }
+                begin += 16;
+            }
+            return skip_whitespace_scalar(begin, end);
+        }
+
+        size_t count_new_lines_sse2(char const *begin, char const *const end)
+        {
+            __m128i const new_line = _mm_set1_epi8('\n');
+            size_t count = 0;
+            while ((end - begin) >= 16)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(begin));
+                count += static_cast<size_t>(
+                    std::popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, new_line)))));
+                begin += 16;
+            }
+            return count + count_new_lines_scalar(begin, end);
+        }
+
+        // SSE2 has no byte shuffle for the table lookups of the AVX2 version, so this only skips ASCII blocks quickly.
+        char const *find_invalid_utf8_sse2(char const *begin, char const *const end)
+        {
+            while ((end - begin) >= 16)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(begin));
+                if (_mm_movemask_epi8(block) == 0)
+                {
+                    begin += 16;
+                    continue;
+                }
+                // a sequence may reach into the next block
+                char const *const block_end = begin + 16;
+                while (begin < block_end)
+                {
+                    if (static_cast<unsigned char>(*begin) < 0x80)
+                    {
+                        ++begin;
+                        continue;
+                    }
+                    char const *const next = skip_multi_byte_sequence(begin, end);
+                    if (!next)
+                    {
+                        return begin;
+                    }
+                    begin = next;
+                }
+            }
+            return find_invalid_utf8_scalar(begin, end);
+        }
+
+        LPG_TARGET_AVX2 char const *find_byte_avx2(char const *begin, char const *const end, char const needle)
+        {
+            __m256i const pattern = _mm256_set1_epi8(needle);
+            while ((end - begin) >= 32)
+            {
+                __m256i const block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin));
+                unsigned const mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern)));
+                if (mask != 0)
+                {
+                    return begin + std::countr_zero(mask);
+                }
+                begin += 32;
+            }
+            return find_byte_sse2(begin, end, needle);
+        }
+
+        LPG_TARGET_AVX2 char const *find_either_avx2(char const *begin, char const *const end, char const first,
+                                                     char const second)
+        {
+            __m256i const first_pattern = _mm256_set1_epi8(first);
+            __m256i const second_pattern = _mm256_set1_epi8(second);
+            while ((end - begin) >= 32)
+            {
+                __m256i const block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin));
+                __m256i const is_either = _mm256_or_si256(_mm256_cmpeq_epi8(block, first_pattern),
+                                                          _mm256_cmpeq_epi8(block, second_pattern));
+                unsigned const mask = static_cast<unsigned>(_mm256_movemask_epi8(is_either));
+                if (mask != 0)
+                {
+                    return begin + std::countr_zero(mask);
+                }
+                begin += 32;
+            }
+            return find_either_sse2(begin, end, first, second);
+        }
+
+        LPG_TARGET_AVX2 char const *find_quote_avx2(char const *begin, char const *const end)
+        {
+            return find_byte_avx2(begin, end, '"');
+        }
+
+        LPG_TARGET_AVX2 char const *find_new_line_avx2(char const *begin, char const *const end)
+        {
+            return find_byte_avx2(begin, end, '\n');
+        }
+
+        LPG_TARGET_AVX2 char const *skip_whitespace_avx2(char const *begin, char const *const end)
+        {
+            __m256i const space = _mm256_set1_epi8(' ');
+            __m256i const new_line = _mm256_set1_epi8('\n');
+            while ((end - begin) >= 32)
+            {
+                __m256i const block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin));
+                __m256i const is_whitespace =
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, new_line));
+                unsigned const non_whitespace = ~static_cast<unsigned>(_mm256_movemask_epi8(is_whitespace));
+                if (non_whitespace != 0)
+                {
+                    return begin + std::countr_zero(non_whitespace);
+                }
+                begin += 32;
+            }
+            return skip_whitespace_sse2(begin, end);
+        }
+
+        LPG_TARGET_AVX2 size_t count_new_lines_avx2(char const *begin, char const *const end)
+        {
+            __m256i const new_line = _mm256_set1_epi8('\n');
+            size_t count = 0;
+            while ((end - begin) >= 32)
+            {
+                __m256i const block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin));
+                count += static_cast<size_t>(
+                    std::popcount(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, new_line)))));
+                begin += 32;
+            }
+            return count + count_new_lines_sse2(begin, end);
+        }
+
+        // The lookup algorithm by Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte". Every
+        // error is detected from a pair of adjacent bytes with three table lookups, except for missing continuation
+        // bytes of three and four byte sequences, which are checked by shifting the input.
+        namespace utf8_errors
+        {
+            // 11______ 0_______ or 11______ 11______
+            constexpr char too_short = 1 << 0;
+            // 0_______ 10______
+            constexpr char too_long = 1 << 1;
+            // 11100000 100_____
+            constexpr char overlong_3 = 1 << 2;
+            // 11110100 1001____ and everything above U+10FFFF that does not begin with 1000
+            constexpr char too_large = 1 << 3;
+            // 11101101 101_____
+            constexpr char surrogate = 1 << 4;
+            // 1100000_ 10______
+            constexpr char overlong_2 = 1 << 5;
+            // 11110000 1000____, or above U+10FFFF and beginning with 1000
+            constexpr char too_large_1000 = 1 << 6;
+            constexpr char overlong_4 = 1 << 6;
+            // 10______ 10______
+            constexpr char two_continuations = static_cast<char>(1 << 7);
+            // errors that only depend on the high nibble of the first byte
+            constexpr char carry = too_short | too_long | two_continuations;
+        } // namespace utf8_errors
+
+        LPG_TARGET_AVX2 __m256i broadcast_table(char const t0, char const t1, char const t2, char const t3,
+                                                char const t4, char const t5, char const t6, char const t7,
+                                                char const t8, char const t9, char const t10, char const t11,
+                                                char const t12, char const t13, char const t14, char const t15)
+        {
+            return _mm256_setr_epi8(t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15, t0, t1, t2,
+                                    t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15);
+        }
+
+        LPG_TARGET_AVX2 __m256i high_nibbles(__m256i const bytes)
+        {
+            return _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0f));
+        }
+
+        LPG_TARGET_AVX2 __m256i check_special_cases(__m256i const input, __m256i const previous1)
+        {
+            using namespace utf8_errors;
+            __m256i const byte_1_high = _mm256_shuffle_epi8(
+                broadcast_table(too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+                                two_continuations, two_continuations, two_continuations, two_continuations,
+                                too_short | overlong_2, too_short, too_short | overlong_3 | surrogate,
+                                too_short | too_large | too_large_1000 | overlong_4),
+                high_nibbles(previous1));
+            __m256i const byte_1_low = _mm256_shuffle_epi8(
+                broadcast_table(carry | overlong_3 | overlong_2 | overlong_4, carry | overlong_2, carry, carry,
+                                carry | too_large, carry | too_large | too_large_1000,
+                                carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+                                carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+                                carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+                                carry | too_large | too_large_1000, carry | too_large | too_large_1000 | surrogate,
+                                carry | too_large | too_large_1000, carry | too_large | too_large_1000),
+                _mm256_and_si256(previous1, _mm256_set1_epi8(0x0f)));
+            __m256i const byte_2_high = _mm256_shuffle_epi8(
+                broadcast_table(too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+                                too_long | overlong_2 | two_continuations | overlong_3 | too_large_1000 | overlong_4,
+                                too_long | overlong_2 | two_continuations | overlong_3 | too_large,
+                                too_long | overlong_2 | two_continuations | surrogate | too_large,
+                                too_long | overlong_2 | two_continuations | surrogate | too_large, too_short,
+                                too_short, too_short, too_short),
+                high_nibbles(input));
+            return _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+        }
+
+        // Returns whether the block contains an error, given the block in front of it.
+        LPG_TARGET_AVX2 __m256i check_utf8_block(__m256i const input, __m256i const previous_input)
+        {
+            // the previous block's upper half followed by this block's lower half
+            __m256i const shifted = _mm256_permute2x128_si256(previous_input, input, 0x21);
+            __m256i const previous1 = _mm256_alignr_epi8(input, shifted, 15);
+            __m256i const previous2 = _mm256_alignr_epi8(input, shifted, 14);
+            __m256i const previous3 = _mm256_alignr_epi8(input, shifted, 13);
+            __m256i const special_cases = check_special_cases(input, previous1);
+            // only 111_____ two bytes back and 1111____ three bytes back end up with the highest bit set
+            __m256i const is_third_byte =
+                _mm256_subs_epu8(previous2, _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+            __m256i const is_fourth_byte =
+                _mm256_subs_epu8(previous3, _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+            __m256i const must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third_byte, is_fourth_byte),
+                                                                  _mm256_set1_epi8(static_cast<char>(0x80)));
+            return _mm256_xor_si256(must_be_continuation, special_cases);
+        }
+
+        // non-zero where a sequence at the end of the block is not complete yet
+        LPG_TARGET_AVX2 __m256i is_incomplete(__m256i const input)
+        {
+            __m256i const maximum = _mm256_setr_epi8(
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+            return _mm256_subs_epu8(input, maximum);
+        }
+
+        struct utf8_checker
+        {
+            __m256i error;
+            __m256i previous_input;
+            __m256i previous_incomplete;
+
+            LPG_TARGET_AVX2 void check(__m256i const input)
+            {
+                if (_mm256_movemask_epi8(input) == 0)
+                {
+                    error = _mm256_or_si256(error, previous_incomplete);
+                }
+                else
+                {
+                    error = _mm256_or_si256(error, check_utf8_block(input, previous_input));
+                    previous_incomplete = is_incomplete(input);
+                }
+                previous_input = input;
+            }
+
+            [[nodiscard]] LPG_TARGET_AVX2 bool has_error() const
+            {
+                return !_mm256_testz_si256(error, error);
+            }
+        };
+
+        LPG_TARGET_AVX2 char const *find_invalid_utf8_avx2(char const *const begin, char const *const end)
+        {
+            utf8_checker checker{_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+            char const *next = begin;
+            for (; (end - next) >= 32; next += 32)
+            {
+                checker.check(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(next)));
+                if (checker.has_error())
+                {
+                    // the error may have begun in an earlier block, so let the scalar version find where
+                    return find_invalid_utf8_scalar(begin, end);
+                }
+            }
+            // zeros are ASCII, so padding the rest does not change the result
+            alignas(32) char rest[32] = {};
+            std::memcpy(rest, next, static_cast<size_t>(end - next));
+            checker.check(_mm256_load_si256(reinterpret_cast<__m256i const *>(rest)));
+            checker.error = _mm256_or_si256(checker.error, checker.previous_incomplete);
+            return checker.has_error() ? find_invalid_utf8_scalar(begin, end) : end;
+        }
+
+        bool cpu_has_avx2() noexcept
+        {
+#ifdef _MSC_VER
+            int registers[4] = {};
+            __cpuid(registers, 0);
+            if (registers[0] < 7)
+            {
+                return false;
+            }
+            __cpuid(registers, 1);
+            bool const os_saves_ymm = ((registers[2] & (1 << 27)) != 0) && ((_xgetbv(0) & 6) == 6);
+            if (!os_saves_ymm)
+            {
+                return false;
+            }
+            __cpuidex(registers, 7, 0);
+            return (registers[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        constexpr kernels scalar_kernels{find_quote_scalar,      find_new_line_scalar,     skip_whitespace_scalar,
+                                         count_new_lines_scalar, find_invalid_utf8_scalar, find_either_scalar};
+#if LPG_SIMD_X86
+        constexpr kernels sse2_kernels{find_quote_sse2,      find_new_line_sse2,     skip_whitespace_sse2,
+                                       count_new_lines_sse2, find_invalid_utf8_sse2, find_either_sse2};
+        constexpr kernels avx2_kernels{find_quote_avx2,      find_new_line_avx2,     skip_whitespace_avx2,
+                                       count_new_lines_avx2, find_invalid_utf8_avx2, find_either_avx2};
+#endif
+    } // namespace
+
+    bool is_supported(instruction_set const which) noexcept
+    {
+        switch (which)
+        {
+        case instruction_set::scalar:
+            return true;
+        case instruction_set::sse2:
+            // SSE2 is part of the x86-64 baseline
+            return (LPG_SIMD_X86 != 0);
+        case instruction_set::avx2:
+#if LPG_SIMD_X86
+            return cpu_has_avx2();
+#else
+            return false;
+#endif
+        }
+        return false;
+    }
+
+    instruction_set detect_instruction_set() noexcept
+    {
+        if (is_supported(instruction_set::avx2))
+        {
+            return instruction_set::avx2;
+        }
+        if (is_supported(instruction_set::sse2))
+        {
+            return instruction_set::sse2;
+        }
+        return instruction_set::scalar;
+    }
+
+    kernels const &get_kernels(instruction_set const which) noexcept
+    {
+        switch (which)
+        {
+        case instruction_set::scalar:
+            return scalar_kernels;
+#if LPG_SIMD_X86
+        case instruction_set::sse2:
+            return sse2_kernels;
+        case instruction_set::avx2:
+            return avx2_kernels;
+#else
+        case instruction_set::sse2:
+        case instruction_set::avx2:
+            return scalar_kernels;
+#endif
+        }
+        return scalar_kernels;
+    }
+
+    kernels const &best_kernels() noexcept
+    {
+        static kernels const &best = get_kernels(detect_instruction_set());
+        return best;
+    }
+} // namespace lpg::simd
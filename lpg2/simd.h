@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+
+namespace lpg::simd
+{
+    enum class instruction_set
+    {
+        scalar,
+        sse2,
+        avx2
+    };
+
+    // All kernels look at the half-open range [begin, end) and return end if they do not find what they are looking
+    // for. They never read outside of that range.
+    struct kernels
+    {
+        char const *(*find_quote)(char const *begin, char const *end);
+        char const *(*find_new_line)(char const *begin, char const *end);
+        // returns the first byte that is not whitespace
+        char const *(*skip_whitespace)(char const *begin, char const *end);
+        size_t (*count_new_lines)(char const *begin, char const *end);
+        // returns the first byte of the first sequence that is not valid UTF-8
+        char const *(*find_invalid_utf8)(char const *begin, char const *end);
+        // returns the first byte that equals first or second
+        char const *(*find_either)(char const *begin, char const *end, char first, char second);
+    };
+
+    [[nodiscard]] bool is_supported(instruction_set which) noexcept;
+    [[nodiscard]] instruction_set detect_instruction_set() noexcept;
+    [[nodiscard]] kernels const &get_kernels(instruction_set which) noexcept;
+
+    // the kernels for the best instruction set the CPU supports, detected once at runtime
+    [[nodiscard]] kernels const &best_kernels() noexcept;
+} // namespace lpg::simd
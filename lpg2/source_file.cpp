@@ -0,0 +1,214 @@
+#include "source_file.h"
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lpg
+{
+    namespace
+    {
+        void check_size(std::uint64_t const size)
+        {
+            if (size > std::numeric_limits<std::uint32_t>::max())
+            {
+                throw std::length_error("The source is too large for 32-bit source locations");
+            }
+        }
+
+#ifdef _WIN32
+        struct handle_closer
+        {
+            HANDLE handle;
+
+            ~handle_closer()
+            {
+                CloseHandle(handle);
+            }
+        };
+
+        [[noreturn]] void throw_last_error(char const *const what)
+        {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+        }
+#else
+        struct descriptor_closer
+        {
+            int descriptor;
+
+            ~descriptor_closer()
+            {
+                close(descriptor);
+            }
+        };
+
+        [[noreturn]] void throw_errno(char const *const what)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        constexpr size_t huge_page_size = size_t{2} * 1024 * 1024;
+
+        // Maps the file at an address aligned to huge_page_size so that the kernel can back it with huge pages if the
+        // file system supports that. Falls back to wherever mmap puts the mapping.
+        [[nodiscard]] void *map_file(int const descriptor, size_t const size)
+        {
+            if (size >= huge_page_size)
+            {
+                void *const reserved =
+                    mmap(nullptr, size + huge_page_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (reserved != MAP_FAILED)
+                {
+                    std::uintptr_t const reserved_begin = reinterpret_cast<std::uintptr_t>(reserved);
+                    std::uintptr_t const aligned_begin =
+                        (reserved_begin + huge_page_size - 1) & ~std::uintptr_t{huge_page_size - 1};
+                    std::uintptr_t const reserved_end = reserved_begin + size + huge_page_size;
+                    // MAP_FIXED replaces the reservation, so only the slack before and after has to be released
+                    void *const mapped = mmap(reinterpret_cast<void *>(aligned_begin), size, PROT_READ,
+                                              MAP_PRIVATE | MAP_FIXED, descriptor, 0);
+                    if (mapped == MAP_FAILED)
+                    {
+                        munmap(reserved, size + huge_page_size);
+                    }
+                    else
+                    {
+                        if (aligned_begin != reserved_begin)
+                        {
+                            munmap(reserved, aligned_begin - reserved_begin);
+                        }
+                        // munmap in the destructor only releases the pages covered by the file
+                        std::uintptr_t const page_size = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+                        std::uintptr_t const slack_begin = (aligned_begin + size + page_size - 1) & ~(page_size - 1);
+                        if (slack_begin < reserved_end)
+                        {
+                            munmap(reinterpret_cast<void *>(slack_begin), reserved_end - slack_begin);
+                        }
+#ifdef MADV_HUGEPAGE
+                        // only a hint, not every kernel and file system can do this
+                        (void)madvise(mapped, size, MADV_HUGEPAGE);
+#endif
+                        return mapped;
+                    }
+                }
+            }
+            return mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        }
+#endif
+    } // namespace
+
+    source_file::source_file(std::filesystem::path const &path)
+    {
+#ifdef _WIN32
+        HANDLE const file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw_last_error("CreateFileW");
+        }
+        handle_closer const file_closer{file};
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size))
+        {
+            throw_last_error("GetFileSizeEx");
+        }
+        check_size(static_cast<std::uint64_t>(file_size.QuadPart));
+        if (file_size.QuadPart == 0)
+        {
+            // an empty file cannot be mapped
+            return;
+        }
+        HANDLE const mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            throw_last_error("CreateFileMappingW");
+        }
+        // the view keeps the mapping alive after the handle is closed
+        handle_closer const mapping_closer{mapping};
+        void const *const view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+        {
+            throw_last_error("MapViewOfFile");
+        }
+        data = static_cast<char const *>(view);
+        size = static_cast<size_t>(file_size.QuadPart);
+#else
+        int const descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0)
+        {
+            throw_errno("open");
+        }
+        descriptor_closer const closer{descriptor};
+        struct stat status;
+        if (fstat(descriptor, &status) != 0)
+        {
+            throw_errno("fstat");
+        }
+        check_size(static_cast<std::uint64_t>(status.st_size));
+        if (status.st_size == 0)
+        {
+            // mmap refuses empty mappings
+            return;
+        }
+        size_t const mapped_size = static_cast<size_t>(status.st_size);
+        void *const mapped = map_file(descriptor, mapped_size);
+        if (mapped == MAP_FAILED)
+        {
+            throw_errno("mmap");
+        }
+        // the source is read once from front to back
+        (void)madvise(mapped, mapped_size, MADV_SEQUENTIAL);
+        data = static_cast<char const *>(mapped);
+        size = mapped_size;
+#endif
+    }
+
+    source_file::source_file(source_file &&other) noexcept
+        : data(std::exchange(other.data, nullptr))
+        , size(std::exchange(other.size, 0))
+    {
+    }
+
+    source_file &source_file::operator=(source_file &&other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            data = std::exchange(other.data, nullptr);
+            size = std::exchange(other.size, 0);
+        }
+        return *this;
+    }
+
+    source_file::~source_file()
+    {
+        unmap();
+    }
+
+    void source_file::unmap() noexcept
+    {
+        if (!data)
+        {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<char *>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+} // namespace lpg
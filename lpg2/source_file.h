@@ -0,0 +1,32 @@
+#pragma once
+#include <filesystem>
+#include <string_view>
+
+namespace lpg
+{
+    // A source file mapped read-only into memory. The mapping does not move when the source_file is moved, so string
+    // views into the content (for example in a syntax tree) stay valid as long as the source_file exists.
+    struct source_file
+    {
+        // Throws std::system_error if the file cannot be opened or mapped and std::length_error if it does not fit into
+        // 32-bit source locations.
+        explicit source_file(std::filesystem::path const &path);
+        source_file(source_file &&other) noexcept;
+        source_file &operator=(source_file &&other) noexcept;
+        ~source_file();
+
+        source_file(source_file const &) = delete;
+        source_file &operator=(source_file const &) = delete;
+
+        [[nodiscard]] std::string_view content() const noexcept
+        {
+            return std::string_view(data, size);
+        }
+
+    private:
+        char const *data = nullptr;
+        size_t size = 0;
+
+        void unmap() noexcept;
+    };
+} // namespace lpg
@@ -0,0 +1,57 @@
+#include "symbol_table.h"
+#include <cassert>
+#include <limits>
+
+namespace lpg::syntax
+{
+    std::ostream &operator<<(std::ostream &out, symbol_id const value)
+    {
+        return out << "symbol " << value.value;
+    }
+
+    symbol_table::symbol_table()
+    {
+        [[maybe_unused]] symbol_id const print = intern("print");
+        assert(print == print_symbol);
+    }
+
+    symbol_table::symbol_table(symbol_table const &other)
+        : ids(other.ids)
+        , names(other.names.size())
+    {
+        // the names have to point into our own copy of the keys
+        for (auto const &[name, symbol] : ids)
+        {
+            names[symbol.value] = name;
+        }
+    }
+
+    symbol_table &symbol_table::operator=(symbol_table const &other)
+    {
+        if (this != &other)
+        {
+            *this = symbol_table(other);
+        }
+        return *this;
+    }
+
+    symbol_id symbol_table::intern(std::string_view const name)
+    {
+        auto const found = ids.find(name);
+        if (found != ids.end())
+        {
+            return found->second;
+        }
+        assert(names.size() < std::numeric_limits<std::uint32_t>::max());
+        symbol_id const result{static_cast<std::uint32_t>(names.size())};
+        auto const inserted = ids.emplace(std::string(name), result).first;
+        names.emplace_back(inserted->first);
+        return result;
+    }
+
+    std::string_view symbol_table::name(symbol_id const symbol) const noexcept
+    {
+        assert(symbol.value < names.size());
+        return names[symbol.value];
+    }
+} // namespace lpg::syntax
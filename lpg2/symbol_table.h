@@ -0,0 +1,57 @@
+#pragma once
+#include <compare>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lpg::syntax
+{
+    // A dense number for an interned identifier. Equal names have equal ids within one symbol_table.
+    struct symbol_id
+    {
+        std::uint32_t value = 0;
+
+        std::weak_ordering operator<=>(symbol_id const &other) const noexcept = default;
+    };
+
+    std::ostream &operator<<(std::ostream &out, symbol_id value);
+
+    // "print" is interned first in every symbol_table.
+    inline constexpr symbol_id print_symbol{0};
+
+    struct symbol_table
+    {
+        symbol_table();
+        symbol_table(symbol_table const &other);
+        symbol_table(symbol_table &&other) noexcept = default;
+        symbol_table &operator=(symbol_table const &other);
+        symbol_table &operator=(symbol_table &&other) noexcept = default;
+        ~symbol_table() = default;
+
+        [[nodiscard]] symbol_id intern(std::string_view name);
+        [[nodiscard]] std::string_view name(symbol_id symbol) const noexcept;
+
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return names.size();
+        }
+
+    private:
+        struct string_hash
+        {
+            using is_transparent = void;
+
+            [[nodiscard]] size_t operator()(std::string_view value) const noexcept
+            {
+                return std::hash<std::string_view>{}(value);
+            }
+        };
+
+        // the keys do not move when the map grows, so names can point into them
+        std::unordered_map<std::string, symbol_id, string_hash, std::equal_to<>> ids;
+        std::vector<std::string_view> names;
+    };
+} // namespace lpg::syntax
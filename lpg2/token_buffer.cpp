@@ -0,0 +1,132 @@
+#include "token_buffer.h"
+#include "token_pipe.h"
+#include <limits>
+#include <stdexcept>
+
+namespace lpg::syntax
+{
+    bool lex_token(std::string_view const source, char const *&next, simd::kernels const &kernels, token_buffer &into,
+                   symbol_table &symbols)
+    {
+        char const *const begin = source.data();
+        raw_token const scanned = scan_token(next, begin + source.size(), kernels);
+        if (scanned.status != scan_status::token)
+        {
+            into.has_invalid_utf8 = (scanned.status == scan_status::invalid_utf8);
+            into.has_failed = into.has_invalid_utf8 || (scanned.status == scan_status::unterminated_string_literal);
+            if (into.has_invalid_utf8)
+            {
+                next = scanned.end;
+            }
+            return false;
+        }
+        std::uint32_t const length = static_cast<std::uint32_t>(scanned.end - next);
+        into.kinds.emplace_back(scanned.kind);
+        into.offsets.emplace_back(static_cast<std::uint32_t>(next - begin));
+        into.lengths.emplace_back(length);
+        into.symbol_ids.emplace_back((scanned.kind == token_kind::identifier)
+                                         ? symbols.intern(std::string_view(next, length))
+                                         : symbol_id{});
+        next = scanned.end;
+        return true;
+    }
+
+    token_buffer tokenize_all(std::string_view const source, simd::kernels const &kernels)
+    {
+        if (source.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("The source is too large for 32-bit token offsets");
+        }
+        token_buffer result;
+        char const *const begin = source.data();
+        char const *const end = begin + source.size();
+        char const *next = begin;
+        for (;;)
+        {
+            if ((next != end) && is_whitespace(*next))
+            {
+                next = kernels.skip_whitespace(next, end);
+            }
+            if ((next == end) || !lex_token(source, next, kernels, result, result.symbols))
+            {
+                break;
+            }
+        }
+        result.end_offset = static_cast<std::uint32_t>(next - begin);
+        return result;
+    }
+
+    token_buffer tokenize_all(std::string_view const source)
+    {
+        return tokenize_all(source, simd::best_kernels());
+    }
+
+    token_cursor::token_cursor(std::string_view source)
+        : token_cursor(source, tokenize_all(source))
+    {
+    }
+
+    token_cursor::token_cursor(std::string_view source, token_buffer tokens)
+        : source(source)
+        , tokens(std::move(tokens))
+    {
+    }
+
+    token_cursor::token_cursor(std::string_view source, token_pipe &pipe)
+        : source(source)
+        , pipe(&pipe)
+    {
+    }
+
+    std::optional<token> token_cursor::pop()
+    {
+        auto result = peek();
+        peeked = std::nullopt;
+        return result;
+    }
+
+    std::optional<token> token_cursor::peek()
+    {
+        if (peeked)
+        {
+            return peeked;
+        }
+
+        while ((next_token == tokens.size()) && pipe && pipe->pop(tokens))
+        {
+            next_token = 0;
+        }
+
+        if (next_token == tokens.size())
+        {
+            next_location = source_location{tokens.end_offset};
+            has_failed = tokens.has_failed;
+            return std::nullopt;
+        }
+
+        std::uint32_t const offset = tokens.offsets[next_token];
+        std::uint32_t const length = tokens.lengths[next_token];
+        peeked = make_token(tokens.kinds[next_token], source.substr(offset, length), tokens.symbol_ids[next_token],
+                            source_location{offset});
+        next_location = source_location{offset + length};
+        ++next_token;
+        return peeked;
+    }
+
+    void token_cursor::skip_comments()
+    {
+        assert(!peeked);
+        for (;;)
+        {
+            while ((next_token < tokens.size()) && (tokens.kinds[next_token] == token_kind::comment))
+            {
+                ++next_token;
+            }
+            if ((next_token < tokens.size()) || !pipe || !pipe->pop(tokens))
+            {
+                return;
+            }
+            next_token = 0;
+        }
+    }
+} // namespace lpg::syntax
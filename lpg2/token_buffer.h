@@ -0,0 +1,66 @@
+#pragma once
+#include "tokenizer.h"
+#include <vector>
+
+namespace lpg::syntax
+{
+    // All tokens of a source in struct-of-arrays form. Token i is described by kinds[i], offsets[i], lengths[i] and
+    // symbol_ids[i]. Offsets are relative to the beginning of the source and cover the whole token including quotes and
+    // slashes. symbol_ids[i] is only meaningful for identifiers.
+    struct token_buffer
+    {
+        std::vector<token_kind> kinds;
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> lengths;
+        std::vector<symbol_id> symbol_ids;
+        symbol_table symbols;
+        // where tokenization stopped: at the end of the source, at an invalid character, at the opening quote of an
+        // unterminated string literal or at the first byte of a string literal or comment that is not valid UTF-8
+        std::uint32_t end_offset = 0;
+        bool has_failed = false;
+        // whether has_failed is because of invalid UTF-8
+        bool has_invalid_utf8 = false;
+
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return kinds.size();
+        }
+    };
+
+    // Lexes the token at next, which must not be whitespace, appends it to the arrays of into and moves next behind it.
+    // Identifiers are interned into symbols. If there is no token at next, returns false after setting has_failed and
+    // has_invalid_utf8 of into and moving next behind invalid UTF-8, so that next is where tokenization ends. Offsets
+    // are relative to source, which next points into.
+    [[nodiscard]] bool lex_token(std::string_view source, char const *&next, simd::kernels const &kernels,
+                                 token_buffer &into, symbol_table &symbols);
+
+    // Lexes the whole source in one go. Throws std::length_error if the source does not fit into 32-bit offsets.
+    [[nodiscard]] token_buffer tokenize_all(std::string_view source, simd::kernels const &kernels);
+    [[nodiscard]] token_buffer tokenize_all(std::string_view source);
+
+    struct token_pipe;
+
+    // Reads a token_buffer with the same interface as scanner.
+    struct token_cursor
+    {
+        std::string_view source;
+        // when reading from a pipe, only the current batch of it
+        token_buffer tokens;
+        token_pipe *pipe = nullptr;
+        size_t next_token = 0;
+        source_location next_location;
+
+        std::optional<token> peeked;
+        bool has_failed = false;
+
+        explicit token_cursor(std::string_view source);
+        token_cursor(std::string_view source, token_buffer tokens);
+        // Reads the batches of the pipe, which has to outlive the cursor, as if they were one token_buffer.
+        token_cursor(std::string_view source, token_pipe &pipe);
+
+        [[nodiscard]] std::optional<token> pop();
+        [[nodiscard]] std::optional<token> peek();
+        // Moves past comments without building tokens for them. Nothing may be peeked.
+        void skip_comments();
+    };
+} // namespace lpg::syntax
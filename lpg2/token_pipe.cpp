@@ -0,0 +1,114 @@
+#include "token_pipe.h"
+
+namespace lpg::syntax
+{
+    token_buffer &token_pipe::begin_push()
+    {
+        size_t const next = pushed.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            size_t const consumed = popped.load(std::memory_order_acquire);
+            if ((next - consumed) < capacity)
+            {
+                break;
+            }
+            popped.wait(consumed, std::memory_order_acquire);
+        }
+        token_buffer &result = batches[next % capacity].tokens;
+        result.kinds.clear();
+        result.offsets.clear();
+        result.lengths.clear();
+        result.symbol_ids.clear();
+        return result;
+    }
+
+    void token_pipe::end_push(bool const is_last)
+    {
+        size_t const next = pushed.load(std::memory_order_relaxed);
+        batches[next % capacity].is_last = is_last;
+        pushed.store(next + 1, std::memory_order_release);
+        pushed.notify_one();
+    }
+
+    bool token_pipe::is_cancelled() const noexcept
+    {
+        return cancelled.load(std::memory_order_relaxed);
+    }
+
+    bool token_pipe::pop(token_buffer &into)
+    {
+        if (has_popped_last)
+        {
+            return false;
+        }
+        size_t const next = popped.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            size_t const produced = pushed.load(std::memory_order_acquire);
+            if (produced != next)
+            {
+                break;
+            }
+            pushed.wait(produced, std::memory_order_acquire);
+        }
+        batch &popping = batches[next % capacity];
+        into.kinds.swap(popping.tokens.kinds);
+        into.offsets.swap(popping.tokens.offsets);
+        into.lengths.swap(popping.tokens.lengths);
+        into.symbol_ids.swap(popping.tokens.symbol_ids);
+        into.end_offset = popping.tokens.end_offset;
+        into.has_failed = popping.tokens.has_failed;
+        into.has_invalid_utf8 = popping.tokens.has_invalid_utf8;
+        has_popped_last = popping.is_last;
+        popped.store(next + 1, std::memory_order_release);
+        popped.notify_one();
+        return true;
+    }
+
+    void token_pipe::cancel()
+    {
+        cancelled.store(true, std::memory_order_relaxed);
+        token_buffer ignored;
+        while (pop(ignored))
+        {
+        }
+    }
+
+    void tokenize_into(std::string_view const source, simd::kernels const &kernels, token_pipe &pipe)
+    {
+        symbol_table symbols;
+        char const *const begin = source.data();
+        char const *const end = begin + source.size();
+        char const *next = begin;
+        for (;;)
+        {
+            token_buffer &batch = pipe.begin_push();
+            batch.has_failed = false;
+            batch.has_invalid_utf8 = false;
+            bool is_last = pipe.is_cancelled();
+            while (!is_last && (batch.size() < token_pipe::batch_size))
+            {
+                if ((next != end) && is_whitespace(*next))
+                {
+                    next = kernels.skip_whitespace(next, end);
+                }
+                if (next == end)
+                {
+                    is_last = true;
+                    break;
+                }
+                if (!lex_token(source, next, kernels, batch, symbols))
+                {
+                    is_last = true;
+                    break;
+                }
+            }
+            batch.end_offset = static_cast<std::uint32_t>(next - begin);
+            pipe.end_push(is_last);
+            if (is_last)
+            {
+                return;
+            }
+        }
+    }
+} // namespace lpg::syntax
@@ -0,0 +1,47 @@
+#pragma once
+#include "token_buffer.h"
+#include <array>
+#include <atomic>
+
+namespace lpg::syntax
+{
+    // A bounded lock-free queue of token batches from one lexer thread to one parser thread. The batches live in the
+    // pipe and their vectors are swapped with those of the consumer, so after the first round no memory is allocated.
+    struct token_pipe
+    {
+        static constexpr size_t capacity = 8;
+        static constexpr size_t batch_size = 4096;
+
+        // Producer: returns an empty batch to fill and blocks while the consumer still has all of them.
+        [[nodiscard]] token_buffer &begin_push();
+        // Producer: hands the batch from begin_push to the consumer. end_offset, has_failed and has_invalid_utf8 of
+        // the last batch describe the whole source.
+        void end_push(bool is_last);
+        // Producer: whether the consumer is no longer interested in the rest of the tokens.
+        [[nodiscard]] bool is_cancelled() const noexcept;
+
+        // Consumer: swaps the next batch into into and blocks until there is one. Returns false after the last one.
+        [[nodiscard]] bool pop(token_buffer &into);
+        // Consumer: tells the producer to stop soon and waits until it has. The pipe can be destroyed afterwards.
+        void cancel();
+
+    private:
+        struct batch
+        {
+            token_buffer tokens;
+            bool is_last = false;
+        };
+
+        std::array<batch, capacity> batches;
+        // the counters only grow, so a batch index is the counter modulo capacity
+        alignas(64) std::atomic<size_t> pushed{0};
+        alignas(64) std::atomic<size_t> popped{0};
+        std::atomic<bool> cancelled{false};
+        // only used by the consumer
+        bool has_popped_last = false;
+    };
+
+    // Lexes the source into the pipe on the calling thread until the end of the source, an error or a cancellation.
+    // The source must fit into 32-bit offsets.
+    void tokenize_into(std::string_view source, simd::kernels const &kernels, token_pipe &pipe);
+} // namespace lpg::syntax
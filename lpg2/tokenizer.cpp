@@ -1,17 +1,17 @@
 #include "tokenizer.h"
+#include <memory>
 #include <stdexcept>
 
 namespace lpg::syntax
 {
-    source_location::source_location(size_t line, size_t column) noexcept
-        : line(line)
-        , column(column)
+    source_location::source_location(std::uint32_t offset) noexcept
+        : offset(offset)
     {
     }
 
     std::ostream &operator<<(std::ostream &out, const source_location &value)
     {
-        return out << (value.line + 1) << ":" << (value.column + 1);
+        return out << "offset " << value.offset;
     }
 
     std::ostream &operator<<(std::ostream &out, const identifier_token &value)
@@ -57,6 +57,8 @@ namespace lpg::syntax
             return out << "true";
         case keyword::false_:
             return out << "false";
+        case keyword::let_:
+            return out << "let";
         }
         LPG_UNREACHABLE();
     }
@@ -72,188 +74,225 @@ namespace lpg::syntax
         return out << value.content << "(" << value.location << ")";
     }
 
-    std::optional<token> scanner::pop()
+    namespace
     {
-        auto result = peek();
-        peeked = std::nullopt;
-        return result;
-    }
-
-    std::optional<token> scanner::peek()
-    {
-        if (peeked)
+        struct keyword_spelling
         {
-            return peeked;
-        }
+            std::string_view spelling;
+            token_kind kind = token_kind::identifier;
+        };
 
-        if (next == end)
+        constexpr std::array<keyword_spelling, 3> keyword_spellings = {{{"true", token_kind::keyword_true},
+                                                                         {"false", token_kind::keyword_false},
+                                                                         {"let", token_kind::keyword_let}}};
+
+        constexpr size_t keyword_table_size = 8;
+
+        // Identifiers are never empty. When adding a keyword, change this function until the static_assert below holds.
+        [[nodiscard]] constexpr size_t hash_keyword(std::string_view const identifier) noexcept
         {
-            return std::nullopt;
+            return (identifier.size() + static_cast<unsigned char>(identifier[0])) % keyword_table_size;
         }
 
-        char head = *next;
-
-        while (is_whitespace(head))
+        [[nodiscard]] constexpr bool is_keyword_hash_perfect() noexcept
         {
-            if (head == '\n')
+            std::array<bool, keyword_table_size> is_used{};
+            for (keyword_spelling const &entry : keyword_spellings)
             {
-                ++next_location.line;
-                next_location.column = 0;
-            }
-            else
-            {
-                ++next_location.column;
+                size_t const slot = hash_keyword(entry.spelling);
+                if (is_used[slot])
+                {
+                    return false;
+                }
+                is_used[slot] = true;
             }
-            next++;
+            return true;
+        }
 
-            if (next == end)
+        static_assert(is_keyword_hash_perfect(), "hash_keyword maps two keywords to the same slot");
+
+        [[nodiscard]] constexpr std::array<keyword_spelling, keyword_table_size> make_keyword_table() noexcept
+        {
+            std::array<keyword_spelling, keyword_table_size> result{};
+            for (keyword_spelling const &entry : keyword_spellings)
             {
-                return std::nullopt;
+                result[hash_keyword(entry.spelling)] = entry;
             }
-            head = *next;
+            return result;
         }
 
-        if (head == '(')
-        {
-            peeked = token{special_character::left_parenthesis, next_location};
-            ++next;
-            ++next_location.column;
-            return peeked;
-        }
-        if (head == ')')
-        {
-            peeked = token{special_character::right_parenthesis, next_location};
-            ++next;
-            ++next_location.column;
-            return peeked;
-        }
-        if (head == '{')
-        {
-            peeked = token{special_character::left_brace, next_location};
-            ++next;
-            ++next_location.column;
-            return peeked;
-        }
-        if (head == '}')
+        constexpr std::array<keyword_spelling, keyword_table_size> keyword_table = make_keyword_table();
+
+        [[nodiscard]] raw_token single_character(token_kind const kind, char const *const begin) noexcept
         {
-            peeked = token{special_character::right_brace, next_location};
-            ++next;
-            ++next_location.column;
-            return peeked;
+            return raw_token{scan_status::token, kind, begin + 1};
         }
-        if (head == ',')
-        {
-            peeked = token{special_character::comma, next_location};
-            ++next;
-            ++next_location.column;
-            return peeked;
-        }
-        if (head == '=')
+    } // namespace
+
+    token_kind find_keyword(std::string_view const identifier) noexcept
+    {
+        // empty slots never match because identifiers are never empty
+        keyword_spelling const &candidate = keyword_table[hash_keyword(identifier)];
+        return (candidate.spelling == identifier) ? candidate.kind : token_kind::identifier;
+    }
+
+    raw_token scan_token(char const *const begin, char const *const end, simd::kernels const &kernels)
+    {
+        assert(begin != end);
+        switch (classify(*begin))
         {
-            source_location const begin_of_token = next_location;
-            ++next;
-            ++next_location.column;
-            if ((next != end) && (*next == '='))
+        case character_class::invalid:
+        case character_class::whitespace:
+            return raw_token{scan_status::invalid_character, token_kind::identifier, begin};
+        case character_class::identifier_letter: {
+            char const *identifier_end = begin + 1;
+            while ((identifier_end != end) && is_identifier_letter(*identifier_end))
             {
-                ++next;
-                ++next_location.column;
-                peeked = token{special_character::equals, begin_of_token};
+                ++identifier_end;
             }
-            else
+            return raw_token{scan_status::token,
+                             find_keyword(std::string_view(begin, static_cast<size_t>(identifier_end - begin))),
+                             identifier_end};
+        }
+        case character_class::left_parenthesis:
+            return single_character(token_kind::left_parenthesis, begin);
+        case character_class::right_parenthesis:
+            return single_character(token_kind::right_parenthesis, begin);
+        case character_class::left_brace:
+            return single_character(token_kind::left_brace, begin);
+        case character_class::right_brace:
+            return single_character(token_kind::right_brace, begin);
+        case character_class::comma:
+            return single_character(token_kind::comma, begin);
+        case character_class::equals_sign:
+            if (((begin + 1) != end) && (begin[1] == '='))
             {
-                peeked = token{special_character::assign, begin_of_token};
+                return raw_token{scan_status::token, token_kind::equals, begin + 2};
             }
-            return peeked;
-        }
-        if (head == '/')
-        {
-            source_location const token_location = next_location;
-            ++next;
-            ++next_location.column;
-
-            if ((next != end) && (*next == '/'))
+            return single_character(token_kind::assign, begin);
+        case character_class::slash:
+            if (((begin + 1) != end) && (begin[1] == '/'))
             {
-                ++next;
-                ++next_location.column;
-                auto const comment_begin = next;
-                for (;;)
+                char const *const line_end = kernels.find_new_line(begin + 2, end);
+                char const *const invalid = kernels.find_invalid_utf8(begin + 2, line_end);
+                if (invalid != line_end)
                 {
-                    if (next == end)
-                    {
-                        break;
-                    }
-                    if (*next == '\n')
-                    {
-                        ++next;
-                        break;
-                    }
-                    ++next;
-                    ++next_location.column;
+                    return raw_token{scan_status::invalid_utf8, token_kind::comment, invalid};
                 }
-                auto const comment_end = next;
-                peeked = token{comment{std::string_view(&*comment_begin, comment_end - comment_begin)}, token_location};
-                return peeked;
+                // the new line belongs to the comment
+                return raw_token{scan_status::token, token_kind::comment, (line_end == end) ? end : (line_end + 1)};
+            }
+            return single_character(token_kind::slash, begin);
+        case character_class::quote: {
+            char const *const quote = kernels.find_quote(begin + 1, end);
+            if (quote == end)
+            {
+                return raw_token{scan_status::unterminated_string_literal, token_kind::string_literal, begin};
+            }
+            char const *const invalid = kernels.find_invalid_utf8(begin + 1, quote);
+            if (invalid != quote)
+            {
+                return raw_token{scan_status::invalid_utf8, token_kind::string_literal, invalid};
             }
+            return raw_token{scan_status::token, token_kind::string_literal, quote + 1};
+        }
+        }
+        LPG_UNREACHABLE();
+    }
 
-            peeked = token{special_character::slash, token_location};
-            return peeked;
+    token make_token(token_kind const kind, std::string_view const text, symbol_id const symbol,
+                     source_location const location)
+    {
+        switch (kind)
+        {
+        case token_kind::identifier:
+            return token{identifier_token{text, symbol}, location};
+        case token_kind::left_parenthesis:
+            return token{special_character::left_parenthesis, location};
+        case token_kind::right_parenthesis:
+            return token{special_character::right_parenthesis, location};
+        case token_kind::left_brace:
+            return token{special_character::left_brace, location};
+        case token_kind::right_brace:
+            return token{special_character::right_brace, location};
+        case token_kind::slash:
+            return token{special_character::slash, location};
+        case token_kind::assign:
+            return token{special_character::assign, location};
+        case token_kind::equals:
+            return token{special_character::equals, location};
+        case token_kind::comma:
+            return token{special_character::comma, location};
+        case token_kind::string_literal:
+            return token{string_literal{text.substr(1, text.size() - 2)}, location};
+        case token_kind::comment:
+            return token{comment{text.substr(2)}, location};
+        case token_kind::keyword_true:
+            return token{keyword::true_, location};
+        case token_kind::keyword_false:
+            return token{keyword::false_, location};
+        case token_kind::keyword_let:
+            return token{keyword::let_, location};
         }
-        if (head == '"')
+        LPG_UNREACHABLE();
+    }
+
+    std::optional<token> scanner::pop()
+    {
+        auto result = peek();
+        peeked = std::nullopt;
+        return result;
+    }
+
+    std::optional<token> scanner::peek()
+    {
+        if (peeked)
         {
-            // only update next if the string literal is valid, so that you can see where the invalid literal began
-            auto i = next;
-            source_location const string_location = next_location;
-            ++i;
-            std::string_view::iterator literal_begin = i;
-            for (;;)
-            {
-                if (i == end)
-                {
-                    has_failed = true;
-                    peeked = std::nullopt;
-                    return peeked;
-                }
-                if (*i == '"')
-                {
-                    break;
-                }
-                ++i;
-            }
-            std::string_view::iterator literal_end = i;
-            ++i;
-            next = i;
-            next_location.column += (next - literal_begin);
-            peeked =
-                token{string_literal{std::string_view(&*literal_begin, literal_end - literal_begin)}, string_location};
             return peeked;
         }
-        if (is_identifier_letter(head))
+
+        if (next == end)
         {
-            std::string_view::iterator identifier_begin = next;
-            source_location const identifier_location = next_location;
-            ++next;
-            ++next_location.column;
-            while ((next != end) && is_identifier_letter(*next))
-            {
-                ++next;
-                ++next_location.column;
-            }
-            auto const identifier_content = std::string_view(&*identifier_begin, next - identifier_begin);
-            if (identifier_content == "true")
-            {
-                peeked = token{keyword::true_, identifier_location};
-            }
-            else if (identifier_content == "false")
-            {
-                peeked = token{keyword::false_, identifier_location};
-            }
-            else
+            return std::nullopt;
+        }
+
+        if (is_whitespace(*next))
+        {
+            char const *const whitespace_begin = std::to_address(next);
+            next += (kernels->skip_whitespace(whitespace_begin, std::to_address(end)) - whitespace_begin);
+            next_location = source_location{static_cast<std::uint32_t>(next - begin)};
+            if (next == end)
             {
-                peeked = token{identifier_token{identifier_content}, identifier_location};
+                return std::nullopt;
             }
+        }
+
+        char const *const token_begin = std::to_address(next);
+        raw_token const scanned = scan_token(token_begin, std::to_address(end), *kernels);
+        switch (scanned.status)
+        {
+        case scan_status::token:
+            break;
+        case scan_status::invalid_character:
+            peeked = std::nullopt;
+            return peeked;
+        case scan_status::unterminated_string_literal:
+            // next is not updated so that you can see where the invalid literal began
+            has_failed = true;
+            peeked = std::nullopt;
+            return peeked;
+        case scan_status::invalid_utf8:
+            has_failed = true;
+            next_location = source_location{static_cast<std::uint32_t>(scanned.end - std::to_address(begin))};
+            peeked = std::nullopt;
             return peeked;
         }
-        peeked = std::nullopt;
+
+        std::string_view const text(token_begin, static_cast<size_t>(scanned.end - token_begin));
+        symbol_id const symbol = (scanned.kind == token_kind::identifier) ? symbols.intern(text) : symbol_id{};
+        peeked = make_token(scanned.kind, text, symbol, next_location);
+        next += (scanned.end - token_begin);
+        next_location = source_location{static_cast<std::uint32_t>(next - begin)};
         return peeked;
     }
 } // namespace lpg::syntax
@@ -1,6 +1,11 @@
 #pragma once
+#include "simd.h"
+#include "symbol_table.h"
+#include <array>
 #include <cassert>
 #include <compare>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <ostream>
 #include <sstream>
@@ -19,21 +24,24 @@
 
 namespace lpg::syntax
 {
+    // A byte offset into the source. Use line_index to turn it into a line and a column.
     struct source_location
     {
-        size_t line = 0;
-        size_t column = 0;
+        std::uint32_t offset = 0;
 
         source_location() noexcept = default;
-        source_location(size_t line, size_t column) noexcept;
+        explicit source_location(std::uint32_t offset) noexcept;
         std::weak_ordering operator<=>(source_location const &other) const noexcept = default;
     };
 
+    // Prints the offset, because the source is not at hand here. The format functions of the errors take a
+    // line_index to show the line and the column instead.
     std::ostream &operator<<(std::ostream &out, const source_location &value);
 
     struct identifier_token
     {
         std::string_view content;
+        symbol_id symbol;
 
         std::weak_ordering operator<=>(identifier_token const &other) const noexcept = default;
     };
@@ -84,7 +92,8 @@ namespace lpg::syntax
     enum class keyword
     {
         true_,
-        false_
+        false_,
+        let_
     };
 
     std::ostream &operator<<(std::ostream &out, keyword value);
@@ -102,29 +111,128 @@ namespace lpg::syntax
 
     std::ostream &operator<<(std::ostream &out, const token &value);
 
+    enum class character_class : std::uint8_t
+    {
+        invalid,
+        whitespace,
+        identifier_letter,
+        left_parenthesis,
+        right_parenthesis,
+        left_brace,
+        right_brace,
+        comma,
+        equals_sign,
+        slash,
+        quote
+    };
+
+    [[nodiscard]] constexpr std::array<character_class, 256> make_character_classes() noexcept
+    {
+        std::array<character_class, 256> result{};
+        result[' '] = character_class::whitespace;
+        result['\n'] = character_class::whitespace;
+        for (char c = 'a'; c <= 'z'; ++c)
+        {
+            result[static_cast<unsigned char>(c)] = character_class::identifier_letter;
+        }
+        result['('] = character_class::left_parenthesis;
+        result[')'] = character_class::right_parenthesis;
+        result['{'] = character_class::left_brace;
+        result['}'] = character_class::right_brace;
+        result[','] = character_class::comma;
+        result['='] = character_class::equals_sign;
+        result['/'] = character_class::slash;
+        result['"'] = character_class::quote;
+        return result;
+    }
+
+    inline constexpr std::array<character_class, 256> character_classes = make_character_classes();
+
+    [[nodiscard]] constexpr character_class classify(char const c) noexcept
+    {
+        return character_classes[static_cast<unsigned char>(c)];
+    }
+
     inline bool is_identifier_letter(char c)
     {
-        return c >= 'a' && c <= 'z';
+        return classify(c) == character_class::identifier_letter;
     }
 
     inline bool is_whitespace(char c)
     {
-        return c == ' ' || c == '\n';
+        return classify(c) == character_class::whitespace;
     }
 
+    enum class token_kind : std::uint8_t
+    {
+        identifier,
+        left_parenthesis,
+        right_parenthesis,
+        left_brace,
+        right_brace,
+        slash,
+        assign,
+        equals,
+        comma,
+        string_literal,
+        comment,
+        keyword_true,
+        keyword_false,
+        keyword_let
+    };
+
+    enum class scan_status : std::uint8_t
+    {
+        token,
+        invalid_character,
+        unterminated_string_literal,
+        // in a string literal or a comment
+        invalid_utf8
+    };
+
+    struct raw_token
+    {
+        scan_status status;
+        token_kind kind;
+        // one past the last byte of the token, or the first byte of the sequence that is not valid UTF-8
+        char const *end;
+    };
+
+    // Returns the token_kind of a keyword, or token_kind::identifier if the identifier is not a keyword.
+    [[nodiscard]] token_kind find_keyword(std::string_view identifier) noexcept;
+
+    // Lexes the token starting at begin, which must not be whitespace, without building a token object. The contents of
+    // string literals and comments are validated as UTF-8 while they are in cache anyway.
+    [[nodiscard]] raw_token scan_token(char const *begin, char const *end, simd::kernels const &kernels);
+
+    // text is the whole token including quotes or slashes. symbol is only used for identifiers.
+    [[nodiscard]] token make_token(token_kind kind, std::string_view text, symbol_id symbol, source_location location);
+
     struct scanner
     {
+        std::string_view::iterator begin;
         std::string_view::iterator next;
         std::string_view::iterator end;
         source_location next_location;
 
         std::optional<token> peeked;
         bool has_failed = false;
+        simd::kernels const *kernels;
+        symbol_table symbols;
 
         explicit scanner(std::string_view source)
-            : next(source.begin())
+            : scanner(source, simd::best_kernels())
+        {
+        }
+
+        scanner(std::string_view source, simd::kernels const &kernels)
+            : begin(source.begin())
+            , next(source.begin())
             , end(source.end())
+            , kernels(&kernels)
         {
+            // locations are 32-bit offsets
+            assert(source.size() <= std::numeric_limits<std::uint32_t>::max());
         }
 
         [[nodiscard]] std::optional<token> pop();
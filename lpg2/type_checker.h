@@ -1,11 +1,15 @@
 #pragma once
-#include "parser.h"
+#include "flat_tree.h"
+#include "overloaded.h"
+#include <span>
 
 namespace lpg::semantics
 {
     struct local_id final
     {
         size_t value;
+
+        std::weak_ordering operator<=>(local_id const &other) const noexcept = default;
     };
 
     enum class builtin_functions
@@ -18,46 +22,100 @@ namespace lpg::semantics
     {
         local_id destination;
         builtin_functions function;
+
+        bool operator==(builtin const &other) const noexcept = default;
     };
 
     struct call final
     {
         local_id result;
         local_id callee;
-        std::vector<local_id> arguments;
+        std::pmr::vector<local_id> arguments;
+
+        bool operator==(call const &other) const = default;
     };
 
     struct string_literal final
     {
         local_id destination;
-        std::string value;
+        std::pmr::string value;
+
+        bool operator==(string_literal const &other) const = default;
     };
 
     struct void_literal final
     {
         local_id destination;
+
+        bool operator==(void_literal const &other) const noexcept = default;
     };
 
     struct poison final
     {
         local_id destination;
+
+        bool operator==(poison const &other) const noexcept = default;
     };
 
     struct boolean_literal final
     {
         local_id destination;
         bool value;
+
+        bool operator==(boolean_literal const &other) const noexcept = default;
     };
 
     struct sequence;
 
     using instruction = std::variant<builtin, call, string_literal, sequence, void_literal, poison, boolean_literal>;
 
+    // The instructions and everything they contain are allocated from the memory_resource passed to check_types.
     struct sequence final
     {
-        std::vector<instruction> elements;
+        std::pmr::vector<instruction> elements;
+
+        bool operator==(sequence const &other) const = default;
     };
 
+    // One more than the largest local_id that input defines.
+    [[nodiscard]] size_t count_locals(sequence const &input);
+
+    // Calls change with a reference to every local_id in element.
+    template <class Change>
+    void for_each_local(instruction &element, Change const &change)
+    {
+        std::visit(overloaded{[&change](builtin &builtin_) {
+                                  change(builtin_.destination);
+                              },
+                              [&change](call &call_) {
+                                  change(call_.result);
+                                  change(call_.callee);
+                                  for (local_id &argument : call_.arguments)
+                                  {
+                                      change(argument);
+                                  }
+                              },
+                              [&change](string_literal &literal) {
+                                  change(literal.destination);
+                              },
+                              [&change](sequence &nested) {
+                                  for (instruction &inner : nested.elements)
+                                  {
+                                      for_each_local(inner, change);
+                                  }
+                              },
+                              [&change](void_literal &literal) {
+                                  change(literal.destination);
+                              },
+                              [&change](poison &poison_) {
+                                  change(poison_.destination);
+                              },
+                              [&change](boolean_literal &literal) {
+                                  change(literal.destination);
+                              }},
+                   element);
+    }
+
     struct semantic_error final
     {
         std::string message;
@@ -67,8 +125,489 @@ namespace lpg::semantics
     };
 
     std::ostream &operator<<(std::ostream &out, semantic_error const &error);
+    // Like operator<<, but with the line and the column of the error instead of its offset.
+    [[nodiscard]] std::string format(semantic_error const &error, syntax::line_index &lines);
 
     using semantic_error_handler = std::function<void(semantic_error)>;
 
-    [[nodiscard]] sequence check_types(syntax::sequence const &input, semantic_error_handler on_error);
+    enum class type
+    {
+        string,
+        void_,
+        print,
+        equals_string,
+        poison,
+        boolean
+    };
+
+    // The bindings around a block that is checked on its own. It is not modified while the block is checked, so that
+    // checkers on several threads can share it.
+    struct enclosing_scope final
+    {
+        std::span<type const> locals;
+        std::span<std::optional<local_id> const> named_local_variables;
+        // the position of every symbol in the order in which they were bound, indexed by symbol_id
+        std::span<std::uint32_t const> binding_positions;
+        // how many of the bindings come before the block
+        size_t visible_bindings;
+
+        [[nodiscard]] std::optional<local_id> find(syntax::symbol_id const symbol) const noexcept
+        {
+            if ((symbol.value >= binding_positions.size()) || (binding_positions[symbol.value] >= visible_bindings))
+            {
+                return std::nullopt;
+            }
+            return named_local_variables[symbol.value];
+        }
+    };
+
+    // ErrorSink is called with every semantic_error. It may be a reference.
+    template <class ErrorSink>
+    struct type_checker final
+    {
+        // where the output and the state of the checker are allocated
+        std::pmr::memory_resource *resource;
+        std::pmr::vector<type> locals;
+        ErrorSink on_error;
+        // The names that are in scope, indexed by symbol_id. Symbols are interned by the scanner, so a lookup is an
+        // index instead of a hash of the name.
+        std::pmr::vector<std::optional<local_id>> named_local_variables;
+        // The symbols that have been bound in the blocks around the current expression, innermost last. A block unbinds
+        // the symbols behind the size this had when the block began.
+        std::pmr::vector<syntax::symbol_id> bound_symbols;
+        // Set when a block is checked on its own. The local_ids below first_local belong to the enclosing scope then.
+        enclosing_scope const *enclosing = nullptr;
+        size_t first_local = 0;
+
+        explicit type_checker(ErrorSink on_error,
+                              std::pmr::memory_resource *const resource = std::pmr::get_default_resource())
+            : resource(resource)
+            , locals(resource)
+            , on_error(std::forward<ErrorSink>(on_error))
+            , named_local_variables(resource)
+            , bound_symbols(resource)
+        {
+        }
+
+        [[nodiscard]] local_id allocate_local(type const local_type)
+        {
+            local_id const result{first_local + locals.size()};
+            locals.emplace_back(local_type);
+            return result;
+        }
+
+        [[nodiscard]] type type_of(local_id const local)
+        {
+            if (local.value < first_local)
+            {
+                assert(enclosing);
+                return enclosing->locals[local.value];
+            }
+            return locals[local.value - first_local];
+        }
+
+        [[nodiscard]] std::optional<local_id> &named_local_variable(syntax::symbol_id const symbol)
+        {
+            if (symbol.value >= named_local_variables.size())
+            {
+                named_local_variables.resize(symbol.value + 1);
+            }
+            return named_local_variables[symbol.value];
+        }
+
+        // Looks a name up in the blocks being checked, and then in the enclosing scope.
+        [[nodiscard]] std::optional<local_id> find_local_variable(syntax::symbol_id const symbol)
+        {
+            std::optional<local_id> const found = named_local_variable(symbol);
+            if (found || !enclosing)
+            {
+                return found;
+            }
+            return enclosing->find(symbol);
+        }
+
+        void bind(syntax::symbol_id const symbol, local_id const value)
+        {
+            named_local_variable(symbol) = value;
+            bound_symbols.emplace_back(symbol);
+        }
+
+        // Unbinds the symbols that have been bound since bound_symbols had scope_begin elements.
+        void leave_scope(size_t const scope_begin)
+        {
+            for (size_t i = scope_begin; i < bound_symbols.size(); ++i)
+            {
+                named_local_variables[bound_symbols[i].value].reset();
+            }
+            bound_symbols.resize(scope_begin);
+        }
+
+        // Passes an error to on_error: only the message id if on_error collects_diagnostics, an empty message if it
+        // ignores messages, and the message otherwise.
+        void report(message_id const message, syntax::source_location const location)
+        {
+            if constexpr (collects_diagnostics<ErrorSink>)
+            {
+                on_error.add(message, location);
+            }
+            else if constexpr (ignores_error_messages<ErrorSink>)
+            {
+                on_error(semantic_error{std::string(), location});
+            }
+            else
+            {
+                on_error(semantic_error{std::string(get_message(message)), location});
+            }
+        }
+
+        // Whether on_error wants no more errors, so that checking can stop early.
+        [[nodiscard]] bool has_enough_errors() const
+        {
+            if constexpr (collects_diagnostics<ErrorSink>)
+            {
+                return on_error.is_full();
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        [[nodiscard]] local_id poison_result(sequence &output)
+        {
+            local_id const poison_id = allocate_local(type::poison);
+            output.elements.emplace_back(poison{poison_id});
+            return poison_id;
+        }
+
+        [[nodiscard]] local_id check_sequence(syntax::flat_tree const &input, syntax::node_data const sequence_input,
+                                              sequence &output)
+        {
+            std::optional<local_id> sequence_result;
+            for (syntax::node_index const element : input.list(sequence_input.first, sequence_input.second))
+            {
+                if (has_enough_errors())
+                {
+                    break;
+                }
+                sequence_result = check_expression(input, element, output);
+            }
+            return finish_sequence(sequence_result, output);
+        }
+
+        [[nodiscard]] local_id check_sequence(syntax::sequence const &input, sequence &output)
+        {
+            std::optional<local_id> sequence_result;
+            for (syntax::expression const &element : input.elements)
+            {
+                if (has_enough_errors())
+                {
+                    break;
+                }
+                sequence_result = check_expression(element, output);
+            }
+            return finish_sequence(sequence_result, output);
+        }
+
+        // The value of a sequence is that of its last element, or void if it is empty.
+        [[nodiscard]] local_id finish_sequence(std::optional<local_id> const last_result, sequence &output)
+        {
+            if (last_result)
+            {
+                return *last_result;
+            }
+            local_id const void_result = allocate_local(type::void_);
+            output.elements.emplace_back(void_literal{void_result});
+            return void_result;
+        }
+
+        [[nodiscard]] local_id check_call(syntax::flat_tree const &input, syntax::node_data const call_input,
+                                          sequence &output)
+        {
+            syntax::node_index const callee_node = input.children[call_input.first];
+            std::span<syntax::node_index const> const argument_nodes =
+                input.list(call_input.first + 1, call_input.second);
+            local_id const callee = check_expression(input, callee_node, output);
+            std::pmr::vector<local_id> arguments(resource);
+            arguments.reserve(argument_nodes.size());
+            for (syntax::node_index const argument_node : argument_nodes)
+            {
+                local_id const argument = check_expression(input, argument_node, output);
+                arguments.emplace_back(argument);
+            }
+            return finish_call(
+                callee, std::move(arguments),
+                [&input, callee_node]() {
+                    return get_location(input, callee_node);
+                },
+                [&input, argument_nodes](size_t const index) {
+                    return get_location(input, argument_nodes[index]);
+                },
+                output);
+        }
+
+        [[nodiscard]] local_id check_call(syntax::call const &call_input, sequence &output)
+        {
+            local_id const callee = check_expression(*call_input.callee, output);
+            std::pmr::vector<local_id> arguments(resource);
+            arguments.reserve(call_input.arguments.size());
+            for (syntax::expression_ptr const &argument_expression : call_input.arguments)
+            {
+                local_id const argument = check_expression(*argument_expression, output);
+                arguments.emplace_back(argument);
+            }
+            return finish_call(
+                callee, std::move(arguments),
+                [&call_input]() {
+                    return get_location(*call_input.callee);
+                },
+                [&call_input](size_t const index) {
+                    return get_location(*call_input.arguments[index]);
+                },
+                output);
+        }
+
+        // Checks a call of which the callee and the arguments have been checked already. The locations are only
+        // looked up for an error.
+        template <class LocateCallee, class LocateArgument>
+        [[nodiscard]] local_id finish_call(local_id const callee, std::pmr::vector<local_id> arguments,
+                                           LocateCallee const &locate_callee, LocateArgument const &locate_argument,
+                                           sequence &output)
+        {
+            type const function_type = type_of(callee);
+            switch (function_type)
+            {
+            case type::string:
+            case type::void_:
+            case type::poison:
+            case type::boolean:
+                report(message_id::not_callable, locate_callee());
+                return poison_result(output);
+            case type::print: {
+                if (type_of(arguments[0]) != type::string)
+                {
+                    report(message_id::argument_type_mismatch, locate_argument(0));
+                    return poison_result(output);
+                }
+                local_id const result = allocate_local(type::void_);
+                output.elements.emplace_back(call{result, callee, std::move(arguments)});
+                return result;
+            }
+            case type::equals_string: {
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    if (type_of(arguments[i]) != type::string)
+                    {
+                        report(message_id::argument_type_mismatch, locate_argument(i));
+                        return poison_result(output);
+                    }
+                }
+                local_id const result = allocate_local(type::boolean);
+                output.elements.emplace_back(call{result, callee, std::move(arguments)});
+                return result;
+            }
+            }
+            LPG_UNREACHABLE();
+        }
+
+        [[nodiscard]] local_id check_expression(syntax::flat_tree const &input, syntax::node_index const node,
+                                                sequence &output)
+        {
+            syntax::node_data const data = input.data[node.value];
+            switch (input.kinds[node.value])
+            {
+            case syntax::node_kind::string_literal: {
+                local_id const local = allocate_local(type::string);
+                output.elements.emplace_back(
+                    string_literal{local, std::pmr::string(input.texts[data.first], resource)});
+                return local;
+            }
+            case syntax::node_kind::identifier: {
+                return check_identifier(syntax::symbol_id{data.second}, get_location(input, node), output);
+            }
+            case syntax::node_kind::call:
+                return check_call(input, data, output);
+            case syntax::node_kind::sequence: {
+                // a block is a scope, so its names can not be used behind it
+                size_t const scope_begin = bound_symbols.size();
+                local_id const result = check_sequence(input, data, output);
+                leave_scope(scope_begin);
+                return result;
+            }
+            case syntax::node_kind::declaration: {
+                syntax::node_index const name{data.first};
+                return check_declaration(syntax::symbol_id{input.data[name.value].second}, get_location(input, name),
+                                         [this, &input, data, &output]() {
+                                             return check_expression(input, syntax::node_index{data.second}, output);
+                                         },
+                                         output);
+            }
+            case syntax::node_kind::bool_literal: {
+                local_id const result_id = allocate_local(type::boolean);
+                output.elements.emplace_back(boolean_literal{result_id, data.first != 0});
+                return result_id;
+            }
+            case syntax::node_kind::binary_operator: {
+                syntax::node_index const left_node = input.children[data.first];
+                local_id const left = check_expression(input, left_node, output);
+                local_id const right = check_expression(input, input.children[data.first + 1], output);
+                return finish_comparison(
+                    left, right,
+                    [&input, left_node]() {
+                        return get_location(input, left_node);
+                    },
+                    output);
+            }
+            case syntax::node_kind::binary_operator_literal:
+                return check_binary_operator_literal(static_cast<syntax::binary_operator>(data.first), output);
+            }
+            LPG_UNREACHABLE();
+        }
+
+        [[nodiscard]] local_id check_expression(syntax::expression const &input, sequence &output)
+        {
+            return std::visit(
+                overloaded{
+                    [this, &output](syntax::string_literal_expression const &string_literal_input) -> local_id {
+                        local_id const local = allocate_local(type::string);
+                        output.elements.emplace_back(string_literal{
+                            local, std::pmr::string(string_literal_input.literal.inner_content, resource)});
+                        return local;
+                    },
+                    [this, &output](syntax::identifier const &identifier_input) -> local_id {
+                        return check_identifier(identifier_input.symbol, identifier_input.location, output);
+                    },
+                    [this, &output](syntax::call const &call_input) -> local_id {
+                        return check_call(call_input, output);
+                    },
+                    [this, &output](syntax::sequence const &sequence_input) -> local_id {
+                        // a block is a scope, so its names can not be used behind it
+                        size_t const scope_begin = bound_symbols.size();
+                        local_id const result = check_sequence(sequence_input, output);
+                        leave_scope(scope_begin);
+                        return result;
+                    },
+                    [this, &output](syntax::declaration const &declaration_input) -> local_id {
+                        return check_declaration(declaration_input.name.symbol, declaration_input.name.location,
+                                                 [this, &declaration_input, &output]() {
+                                                     return check_expression(*declaration_input.initializer, output);
+                                                 },
+                                                 output);
+                    },
+                    [this, &output](syntax::bool_literal_expression const &bool_input) -> local_id {
+                        local_id const result_id = allocate_local(type::boolean);
+                        output.elements.emplace_back(boolean_literal{result_id, bool_input.literal.inner_content});
+                        return result_id;
+                    },
+                    [this, &output](syntax::binary_operator_expression const &binary_operator_input) -> local_id {
+                        local_id const left = check_expression(*binary_operator_input.left, output);
+                        local_id const right = check_expression(*binary_operator_input.right, output);
+                        return finish_comparison(
+                            left, right,
+                            [&binary_operator_input]() {
+                                return get_location(*binary_operator_input.left);
+                            },
+                            output);
+                    },
+                    [this, &output](syntax::binary_operator_literal_expression const &literal_input) -> local_id {
+                        return check_binary_operator_literal(literal_input.which, output);
+                    }},
+                input.value);
+        }
+
+        [[nodiscard]] local_id check_identifier(syntax::symbol_id const symbol, syntax::source_location const location,
+                                                sequence &output)
+        {
+            if (symbol == syntax::print_symbol)
+            {
+                local_id const destination = allocate_local(type::print);
+                output.elements.emplace_back(builtin{destination, builtin_functions::print});
+                return destination;
+            }
+            std::optional<local_id> const found = find_local_variable(symbol);
+            if (!found)
+            {
+                report(message_id::unknown_identifier, location);
+                return poison_result(output);
+            }
+            return *found;
+        }
+
+        // check_initializer is called after the name has been looked up, and before it is bound.
+        template <class CheckInitializer>
+        [[nodiscard]] local_id check_declaration(syntax::symbol_id const symbol, syntax::source_location const location,
+                                                 CheckInitializer const &check_initializer, sequence &output)
+        {
+            bool const name_exists = find_local_variable(symbol).has_value();
+            if (name_exists)
+            {
+                report(message_id::local_already_exists, location);
+            }
+            local_id const initializer = check_initializer();
+            if (!name_exists)
+            {
+                bind(symbol, initializer);
+            }
+            local_id const void_id = allocate_local(type::void_);
+            output.elements.emplace_back(void_literal{void_id});
+            return void_id;
+        }
+
+        // Compares the operands of ==, which have been checked already.
+        template <class LocateLeft>
+        [[nodiscard]] local_id finish_comparison(local_id const left, local_id const right,
+                                                 LocateLeft const &locate_left, sequence &output)
+        {
+            if ((type_of(left) != type::string) || (type_of(right) != type::string))
+            {
+                report(message_id::types_not_comparable, locate_left());
+                return poison_result(output);
+            }
+            local_id const callee = allocate_local(type::equals_string);
+            output.elements.emplace_back(builtin{callee, builtin_functions::equals_string});
+            local_id const result = allocate_local(type::boolean);
+            output.elements.emplace_back(call{result, callee, std::pmr::vector<local_id>({left, right}, resource)});
+            return result;
+        }
+
+        [[nodiscard]] local_id check_binary_operator_literal(syntax::binary_operator const which, sequence &output)
+        {
+            switch (which)
+            {
+            case syntax::binary_operator::equals:
+                local_id const destination = allocate_local(type::equals_string);
+                output.elements.emplace_back(builtin{destination, builtin_functions::equals_string});
+                return destination;
+            }
+            LPG_UNREACHABLE();
+        }
+    };
+
+    // The result is allocated from resource, which has to outlive it.
+    template <class ErrorSink>
+    [[nodiscard]] sequence check_types(syntax::flat_tree const &input, ErrorSink &&on_error,
+                                       std::pmr::memory_resource *const resource = std::pmr::get_default_resource())
+    {
+        type_checker<ErrorSink &> checker(on_error, resource);
+        sequence result{std::pmr::vector<instruction>(resource)};
+        (void)checker.check_sequence(input, input.data[input.root().value], result);
+        return result;
+    }
+
+    // Checks the tree that the parser built, without flattening it.
+    template <class ErrorSink>
+    [[nodiscard]] sequence check_types(syntax::sequence const &input, ErrorSink &&on_error,
+                                       std::pmr::memory_resource *const resource = std::pmr::get_default_resource())
+    {
+        type_checker<ErrorSink &> checker(on_error, resource);
+        sequence result{std::pmr::vector<instruction>(resource)};
+        (void)checker.check_sequence(input, result);
+        return result;
+    }
+
+    // The type-erased versions of the templates above.
+    [[nodiscard]] sequence check_types(syntax::flat_tree const &input, semantic_error_handler on_error,
+                                       std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+    [[nodiscard]] sequence check_types(syntax::sequence const &input, semantic_error_handler on_error,
+                                       std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 } // namespace lpg::semantics
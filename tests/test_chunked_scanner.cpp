@@ -0,0 +1,109 @@
+#include "lpg2/chunked_scanner.h"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    struct scanned_token
+    {
+        std::string text;
+        lpg::syntax::source_location location;
+
+        std::weak_ordering operator<=>(scanned_token const &other) const noexcept = default;
+    };
+
+    // token contents do not outlive the next peek, so we copy them
+    scanned_token copy_token(lpg::syntax::token const &value)
+    {
+        return scanned_token{lpg::format(value.content), value.location};
+    }
+
+    lpg::syntax::chunk_reader read_from(std::string_view const source)
+    {
+        return [source, position = size_t{0}](std::span<char> buffer) mutable -> size_t {
+            size_t const length = std::min(buffer.size(), source.size() - position);
+            std::memcpy(buffer.data(), source.data() + position, length);
+            position += length;
+            return length;
+        };
+    }
+
+    void check_chunked_matches_scanner(std::string_view const source)
+    {
+        std::vector<scanned_token> expected;
+        lpg::syntax::scanner whole(source);
+        while (std::optional<lpg::syntax::token> t = whole.pop())
+        {
+            expected.emplace_back(copy_token(*t));
+        }
+
+        for (size_t chunk_capacity = 1; chunk_capacity <= (source.size() + 1); ++chunk_capacity)
+        {
+            lpg::syntax::chunked_scanner chunked(read_from(source), chunk_capacity);
+            std::vector<scanned_token> got;
+            while (std::optional<lpg::syntax::token> t = chunked.pop())
+            {
+                got.emplace_back(copy_token(*t));
+            }
+            CHECK(expected == got);
+            CHECK(whole.next_location == chunked.next_location);
+            CHECK(whole.has_failed == chunked.has_failed);
+            CHECK(chunked.chunk.size() == chunk_capacity);
+        }
+    }
+} // namespace
+
+TEST_CASE("chunked_scanner_nothing")
+{
+    check_chunked_matches_scanner("");
+    check_chunked_matches_scanner("  \n ");
+}
+
+TEST_CASE("chunked_scanner_tokens_across_chunks")
+{
+    check_chunked_matches_scanner("let abc = \"Hello, world!\"\nprint(abc)\n");
+    check_chunked_matches_scanner("a == b\n//comment\n/ = {} , true false truex le lets");
+    check_chunked_matches_scanner("x //comment at the end");
+    check_chunked_matches_scanner("x/");
+    check_chunked_matches_scanner("x=");
+    check_chunked_matches_scanner("\"multi\nline\"\"\"\"a\"");
+}
+
+TEST_CASE("chunked_scanner_unterminated_string")
+{
+    check_chunked_matches_scanner("a \"unterminated");
+}
+
+TEST_CASE("chunked_scanner_invalid_character")
+{
+    check_chunked_matches_scanner("abc + def");
+}
+
+TEST_CASE("chunked_scanner_utf8_across_chunks")
+{
+    check_chunked_matches_scanner("\"\xc3\xa4\xf0\x9f\x98\x80\" //\xe2\x82\xac\xe2\x82\xac\na");
+}
+
+TEST_CASE("chunked_scanner_invalid_utf8")
+{
+    check_chunked_matches_scanner("a \"\xc3\xa4\xc3\" b");
+    check_chunked_matches_scanner("a //\xe2\x82\xac\xe2\x82\nb");
+    check_chunked_matches_scanner("a //\xe2\x82");
+}
+
+TEST_CASE("chunked_scanner_spill_holds_only_the_current_token")
+{
+    std::string const source = "abc " + std::string(100, 'x') + " \"" + std::string(50, ' ') + "\"";
+    lpg::syntax::chunked_scanner chunked(read_from(source), 8);
+    CHECK(std::get<lpg::syntax::identifier_token>(chunked.pop().value().content).content == "abc");
+    CHECK(chunked.spill.empty());
+    CHECK(std::get<lpg::syntax::identifier_token>(chunked.pop().value().content).content == std::string(100, 'x'));
+    CHECK(chunked.spill.size() == 100);
+    CHECK(std::get<lpg::syntax::string_literal>(chunked.pop().value().content).inner_content ==
+          std::string(50, ' '));
+    CHECK(chunked.spill.size() == 52);
+    CHECK(!chunked.pop());
+    CHECK(!chunked.has_failed);
+}
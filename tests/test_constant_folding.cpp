@@ -0,0 +1,132 @@
+#include "lpg2/constant_folding.h"
+#include "lpg2/interpreter.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+namespace
+{
+    [[nodiscard]] lpg::semantics::sequence check(std::string_view const source)
+    {
+        lpg::syntax::line_index lines(source);
+        return lpg::semantics::check_types(
+            lpg::syntax::compile(source,
+                                 [&lines](lpg::syntax::parse_error const &error) {
+                                     FAIL(format(error, lines));
+                                 }),
+            [](lpg::semantics::semantic_error const &) {
+            });
+    }
+
+    [[nodiscard]] size_t count_calls(lpg::semantics::sequence const &program)
+    {
+        size_t count = 0;
+        for (lpg::semantics::instruction const &element : program.elements)
+        {
+            if (std::holds_alternative<lpg::semantics::call>(element))
+            {
+                ++count;
+            }
+            else if (lpg::semantics::sequence const *const nested = std::get_if<lpg::semantics::sequence>(&element))
+            {
+                count += count_calls(*nested);
+            }
+        }
+        return count;
+    }
+
+    // Returns the folded program, which has to behave like the checked one.
+    lpg::semantics::sequence check_folding_keeps_result(std::string_view const source)
+    {
+        lpg::semantics::sequence const checked = check(source);
+        lpg::semantics::sequence folded = lpg::semantics::fold_constants(checked);
+        CHECK(lpg::evaluate(checked) == lpg::evaluate(folded));
+        return folded;
+    }
+} // namespace
+
+TEST_CASE("fold_constants_nothing")
+{
+    lpg::semantics::sequence const folded = check_folding_keeps_result("");
+    CHECK(lpg::semantics::sequence{{lpg::semantics::void_literal{lpg::semantics::local_id{0}}}} == folded);
+}
+
+TEST_CASE("fold_constants_equals")
+{
+    using namespace lpg::semantics;
+    sequence const folded = check_folding_keeps_result(R"(let a = "a" == "b")");
+    sequence const expected{{string_literal{local_id{0}, "a"}, string_literal{local_id{1}, "b"},
+                             builtin{local_id{2}, builtin_functions::equals_string},
+                             boolean_literal{local_id{3}, false}, void_literal{local_id{4}}}};
+    CHECK(expected == folded);
+}
+
+TEST_CASE("fold_constants_prints")
+{
+    using namespace lpg::semantics;
+    sequence const folded = check_folding_keeps_result("print(\"a\")\n{ let b = \"b\" print(b) }");
+    sequence const expected{{builtin{local_id{0}, builtin_functions::print}, string_literal{local_id{1}, "a"},
+                             string_literal{local_id{3}, "b"}, void_literal{local_id{4}},
+                             builtin{local_id{5}, builtin_functions::print}, string_literal{local_id{7}, "ab"},
+                             builtin{local_id{8}, builtin_functions::print},
+                             call{local_id{9}, local_id{8}, {local_id{7}}}}};
+    CHECK(expected == folded);
+}
+
+TEST_CASE("fold_constants_stops_at_poison")
+{
+    using namespace lpg::semantics;
+    sequence const folded = check_folding_keeps_result(R"(print("a") print(b) print("c"))");
+    sequence const expected{{builtin{local_id{0}, builtin_functions::print}, string_literal{local_id{1}, "a"},
+                             builtin{local_id{3}, builtin_functions::print}, string_literal{local_id{9}, "a"},
+                             builtin{local_id{10}, builtin_functions::print},
+                             call{local_id{11}, local_id{10}, {local_id{9}}}, poison{local_id{4}}}};
+    CHECK(expected == folded);
+}
+
+TEST_CASE("fold_constants_random")
+{
+    std::mt19937 random(3);
+    for (size_t program = 0; program < 50; ++program)
+    {
+        auto const name = [&random] {
+            return std::string(1, static_cast<char>('a' + std::uniform_int_distribution<int>(0, 3)(random)));
+        };
+        std::string source;
+        for (size_t statement = 0; statement < 20; ++statement)
+        {
+            switch (std::uniform_int_distribution<int>(0, 4)(random))
+            {
+            case 0:
+                source += "let " + name() + " = \"" + name() + "\"\n";
+                break;
+            case 1:
+                source += "print(" + name() + ")\n";
+                break;
+            case 2:
+                source += "let " + name() + " = " + name() + " == \"a\"\n";
+                break;
+            case 3:
+                source += "{ let " + name() + " = " + name() + " print(\"" + name() + "\") }\n";
+                break;
+            default:
+                source += "print(\"" + name() + "\")\n";
+                break;
+            }
+        }
+        lpg::semantics::sequence const folded = check_folding_keeps_result(source);
+        // without errors, all the output is known before the program runs
+        size_t errors = 0;
+        lpg::syntax::line_index lines(source);
+        (void)lpg::semantics::check_types(lpg::syntax::compile(source,
+                                                               [&lines](lpg::syntax::parse_error const &error) {
+                                                                   FAIL(format(error, lines));
+                                                               }),
+                                          [&errors](lpg::semantics::semantic_error const &) {
+                                              ++errors;
+                                          });
+        if (errors == 0)
+        {
+            CHECK(count_calls(folded) <= 1);
+        }
+    }
+}
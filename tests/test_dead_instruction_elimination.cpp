@@ -0,0 +1,115 @@
+#include "lpg2/constant_folding.h"
+#include "lpg2/dead_instruction_elimination.h"
+#include "lpg2/interpreter.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+namespace
+{
+    [[nodiscard]] lpg::semantics::sequence check(std::string_view const source)
+    {
+        lpg::syntax::line_index lines(source);
+        return lpg::semantics::check_types(
+            lpg::syntax::compile(source,
+                                 [&lines](lpg::syntax::parse_error const &error) {
+                                     FAIL(format(error, lines));
+                                 }),
+            [](lpg::semantics::semantic_error const &) {
+            });
+    }
+
+    // Returns the checked program without its dead instructions, which has to behave like the checked one.
+    lpg::semantics::sequence check_elimination_keeps_result(std::string_view const source)
+    {
+        lpg::semantics::sequence const checked = check(source);
+        lpg::semantics::sequence eliminated = checked;
+        lpg::semantics::eliminate_dead_instructions(eliminated);
+        CHECK(lpg::evaluate(checked) == lpg::evaluate(eliminated));
+
+        lpg::semantics::sequence folded = lpg::semantics::fold_constants(checked);
+        lpg::semantics::eliminate_dead_instructions(folded);
+        CHECK(lpg::evaluate(checked) == lpg::evaluate(folded));
+        return eliminated;
+    }
+} // namespace
+
+TEST_CASE("eliminate_dead_instructions_nothing")
+{
+    CHECK(lpg::semantics::sequence{} == check_elimination_keeps_result(""));
+    CHECK(lpg::semantics::sequence{} == check_elimination_keeps_result("let a = \"a\" == \"b\"\n{ let b = a }"));
+}
+
+TEST_CASE("eliminate_dead_instructions_keeps_prints")
+{
+    using namespace lpg::semantics;
+    sequence const eliminated = check_elimination_keeps_result("let a = \"a\"\nlet p = print\nlet b = a == a\np(a)");
+    sequence const expected{{string_literal{local_id{0}, "a"}, builtin{local_id{2}, builtin_functions::print},
+                             call{local_id{7}, local_id{2}, {local_id{0}}}}};
+    CHECK(expected == eliminated);
+}
+
+TEST_CASE("eliminate_dead_instructions_stops_at_poison")
+{
+    using namespace lpg::semantics;
+    sequence const eliminated = check_elimination_keeps_result(R"(print("a") print(b) print("c"))");
+    sequence const expected{{builtin{local_id{0}, builtin_functions::print}, string_literal{local_id{1}, "a"},
+                             call{local_id{2}, local_id{0}, {local_id{1}}}, poison{local_id{4}}}};
+    CHECK(expected == eliminated);
+}
+
+TEST_CASE("eliminate_dead_instructions_keeps_failing_calls")
+{
+    // check_types accepts too many arguments for ==, but evaluating such a call fails
+    for (std::string_view const source : {R"(==("a", "b", "c"))", "let d = ==\nd(\"a\", \"b\", \"c\")"})
+    {
+        lpg::semantics::sequence const eliminated = check_elimination_keeps_result(source);
+        CHECK(std::holds_alternative<lpg::evaluate_error>(lpg::evaluate(eliminated)));
+    }
+}
+
+TEST_CASE("eliminate_dead_instructions_nested")
+{
+    using namespace lpg::semantics;
+    sequence program{{builtin{local_id{0}, builtin_functions::print},
+                      sequence{{string_literal{local_id{1}, "a"}, void_literal{local_id{2}}}},
+                      sequence{{boolean_literal{local_id{3}, true}}}, call{local_id{4}, local_id{0}, {local_id{1}}}}};
+    eliminate_dead_instructions(program);
+    sequence const expected{{builtin{local_id{0}, builtin_functions::print},
+                             sequence{{string_literal{local_id{1}, "a"}}},
+                             call{local_id{4}, local_id{0}, {local_id{1}}}}};
+    CHECK(expected == program);
+}
+
+TEST_CASE("eliminate_dead_instructions_random")
+{
+    std::mt19937 random(5);
+    for (size_t program = 0; program < 50; ++program)
+    {
+        auto const name = [&random] {
+            return std::string(1, static_cast<char>('a' + std::uniform_int_distribution<int>(0, 3)(random)));
+        };
+        std::string source;
+        for (size_t statement = 0; statement < 20; ++statement)
+        {
+            switch (std::uniform_int_distribution<int>(0, 4)(random))
+            {
+            case 0:
+                source += "let " + name() + " = \"" + name() + "\"\n";
+                break;
+            case 1:
+                source += name() + "(" + name() + ")\n";
+                break;
+            case 2:
+                source += "let " + name() + " = " + name() + " == \"a\"\n";
+                break;
+            case 3:
+                source += "let " + name() + " = print\n";
+                break;
+            default:
+                source += "{ let " + name() + " = " + name() + " print(\"" + name() + "\") }\n";
+                break;
+            }
+        }
+        (void)check_elimination_keeps_result(source);
+    }
+}
@@ -0,0 +1,109 @@
+#include "lpg2/type_checker.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("diagnostics_messages")
+{
+    for (std::uint8_t i = 0; i <= static_cast<std::uint8_t>(lpg::message_id::types_not_comparable); ++i)
+    {
+        CHECK(!lpg::get_message(static_cast<lpg::message_id>(i)).empty());
+    }
+}
+
+TEST_CASE("diagnostics_arguments")
+{
+    lpg::diagnostics collected;
+    collected.add(lpg::message_id::invalid_initializer, lpg::syntax::source_location{4}, "abc");
+    collected.add(lpg::message_id::unknown_identifier, lpg::syntax::source_location{5});
+    collected.add(lpg::message_id::invalid_initializer, lpg::syntax::source_location{6}, "de");
+    REQUIRE(collected.entries.size() == 3);
+    CHECK(collected.arguments == "abcde");
+    CHECK(collected.format(collected.entries[0]) == "Invalid initializer value for identifier: abc");
+    CHECK(collected.format(collected.entries[1]) == "Unknown identifier");
+    CHECK(collected.format(collected.entries[2]) == "Invalid initializer value for identifier: de");
+}
+
+TEST_CASE("diagnostics_deduplication")
+{
+    lpg::diagnostics collected;
+    collected.add(lpg::message_id::unknown_identifier, lpg::syntax::source_location{1});
+    collected.add(lpg::message_id::unknown_identifier, lpg::syntax::source_location{1});
+    collected.add(lpg::message_id::not_callable, lpg::syntax::source_location{1});
+    collected.add(lpg::message_id::unknown_identifier, lpg::syntax::source_location{2});
+    CHECK(collected.entries.size() == 3);
+    CHECK(collected.duplicates == 1);
+}
+
+TEST_CASE("diagnostics_maximum")
+{
+    lpg::diagnostics collected(2);
+    for (std::uint32_t i = 0; i < 10; ++i)
+    {
+        CHECK(collected.is_full() == (i >= 2));
+        collected.add(lpg::message_id::unknown_identifier, lpg::syntax::source_location{i});
+    }
+    CHECK(collected.entries.size() == 2);
+}
+
+TEST_CASE("compile_into_diagnostics")
+{
+    std::string_view const source = "let a = )";
+    std::vector<lpg::syntax::parse_error> expected;
+    (void)lpg::syntax::compile(source, [&expected](lpg::syntax::parse_error error) {
+        expected.emplace_back(std::move(error));
+    });
+    lpg::diagnostics collected;
+    (void)lpg::syntax::compile(source, collected);
+    REQUIRE(collected.entries.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        CHECK(collected.format(collected.entries[i]) == expected[i].error_message);
+        CHECK(collected.entries[i].where == expected[i].where);
+    }
+}
+
+TEST_CASE("diagnostics_stop_early")
+{
+    lpg::diagnostics parse_errors(1);
+    (void)lpg::syntax::compile("{ ) }\n)", parse_errors);
+    CHECK(parse_errors.entries.size() == 1);
+
+    std::string source;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        source += "print(unknown)\n";
+    }
+    lpg::discard_errors discard;
+    lpg::syntax::sequence const parsed = lpg::syntax::compile(source, discard);
+    lpg::diagnostics type_errors(10);
+    lpg::semantics::sequence const checked = lpg::semantics::check_types(parsed, type_errors);
+    CHECK(type_errors.entries.size() == 10);
+    lpg::count_errors all_type_errors;
+    CHECK(checked.elements.size() < lpg::semantics::check_types(parsed, all_type_errors).elements.size());
+    CHECK(all_type_errors.count == 2000);
+}
+
+TEST_CASE("diagnostics_show_lines_and_columns")
+{
+    // the string has three code points and four bytes
+    std::string_view const source = "let a = \"a\"\n\"\xc3\xa4\" a(b)\n)";
+    lpg::syntax::line_index lines(source);
+
+    std::vector<lpg::syntax::parse_error> parse_errors;
+    lpg::syntax::sequence const parsed = lpg::syntax::compile(source, [&parse_errors](lpg::syntax::parse_error error) {
+        parse_errors.emplace_back(std::move(error));
+    });
+    REQUIRE(!parse_errors.empty());
+    CHECK(lpg::syntax::format(parse_errors.back(), lines) == "3:1: " + parse_errors.back().error_message);
+
+    std::vector<lpg::semantics::semantic_error> semantic_errors;
+    (void)lpg::semantics::check_types(parsed, [&semantic_errors](lpg::semantics::semantic_error error) {
+        semantic_errors.emplace_back(std::move(error));
+    });
+    REQUIRE(!semantic_errors.empty());
+    CHECK(lpg::semantics::format(semantic_errors.back(), lines) == "2:5: This value is not callable");
+
+    lpg::diagnostics collected;
+    (void)lpg::semantics::check_types(parsed, collected);
+    REQUIRE(!collected.entries.empty());
+    CHECK(collected.format(collected.entries.front(), lines) == "2:7: Unknown identifier");
+}
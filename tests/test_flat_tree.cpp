@@ -0,0 +1,56 @@
+#include "lpg2/flat_tree.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    [[nodiscard]] lpg::syntax::sequence parse(std::string_view const source)
+    {
+        lpg::syntax::line_index lines(source);
+        return lpg::syntax::compile(source, [&lines](lpg::syntax::parse_error const &error) {
+            FAIL(format(error, lines));
+        });
+    }
+
+    void check_locations(lpg::syntax::expression const &tree, lpg::syntax::flat_tree const &flat,
+                         lpg::syntax::node_index const node)
+    {
+        CHECK(lpg::syntax::get_location(tree) == lpg::syntax::get_location(flat, node));
+    }
+} // namespace
+
+TEST_CASE("flatten_empty_sequence")
+{
+    lpg::syntax::flat_tree const flat = lpg::syntax::flatten(parse(""));
+    REQUIRE(flat.size() == 1);
+    CHECK(flat.kinds[0] == lpg::syntax::node_kind::sequence);
+    CHECK(flat.data[0].second == 0);
+    CHECK(flat.root() == lpg::syntax::node_index{0});
+}
+
+TEST_CASE("flatten_puts_children_first")
+{
+    lpg::syntax::sequence const parsed = parse("let a = \"b\"\nprint(a == a, true)\n{==}");
+    lpg::syntax::flat_tree const flat = lpg::syntax::flatten(parsed);
+    CHECK(flat.kinds == std::pmr::vector<lpg::syntax::node_kind>{
+                                 lpg::syntax::node_kind::identifier, lpg::syntax::node_kind::string_literal,
+                                 lpg::syntax::node_kind::declaration, lpg::syntax::node_kind::identifier,
+                                 lpg::syntax::node_kind::identifier, lpg::syntax::node_kind::identifier,
+                                 lpg::syntax::node_kind::binary_operator, lpg::syntax::node_kind::bool_literal,
+                                 lpg::syntax::node_kind::call, lpg::syntax::node_kind::binary_operator_literal,
+                                 lpg::syntax::node_kind::sequence, lpg::syntax::node_kind::sequence});
+    CHECK(flat.texts == std::pmr::vector<std::string_view>{"a", "b", "print", "a", "a"});
+    lpg::syntax::node_data const root = flat.data[flat.root().value];
+    std::span<lpg::syntax::node_index const> const elements = flat.list(root.first, root.second);
+    REQUIRE(elements.size() == 3);
+    CHECK(elements[0] == lpg::syntax::node_index{2});
+    CHECK(elements[1] == lpg::syntax::node_index{8});
+    CHECK(elements[2] == lpg::syntax::node_index{10});
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        check_locations(parsed.elements[i], flat, elements[i]);
+    }
+    lpg::syntax::node_data const call = flat.data[8];
+    CHECK(flat.children[call.first] == lpg::syntax::node_index{3});
+    CHECK(flat.list(call.first + 1, call.second).size() == 2);
+    CHECK(flat.data[7].first == 1);
+}
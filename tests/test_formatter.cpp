@@ -5,14 +5,21 @@ namespace
 {
     void test_formatter_roundtrip(std::string_view const &source)
     {
-        lpg::syntax::parser parser{lpg::syntax::scanner{source}, [](lpg::syntax::parse_error const &error) {
-                                       FAIL(error);
+        lpg::syntax::line_index lines(source);
+        lpg::syntax::parser parser{lpg::syntax::token_cursor{source}, [&lines](lpg::syntax::parse_error const &error) {
+                                       FAIL(format(error, lines));
                                    }};
         lpg::syntax::sequence const parsed = parser.parse_sequence(false, lpg::syntax::source_location{});
         std::ostringstream buffer;
         lpg::syntax::formatter formatter{buffer, 0};
         formatter.format(parsed);
         CHECK(source == buffer.str());
+
+        std::ostringstream flat_buffer;
+        lpg::syntax::formatter flat_formatter{flat_buffer, 0};
+        lpg::syntax::flat_tree const flat = lpg::syntax::flatten(parsed);
+        flat_formatter.format(flat, flat.root());
+        CHECK(source == flat_buffer.str());
     }
 } // namespace
 
@@ -49,6 +56,16 @@ TEST_CASE("format_binary_expression")
     test_formatter_roundtrip("a == b\n");
 }
 
+TEST_CASE("format_nested_binary_expression")
+{
+    // == is left-associative, so only an operator on the right side needs parentheses
+    test_formatter_roundtrip("a == b == c\n");
+    test_formatter_roundtrip("a == (b == c)\n");
+    test_formatter_roundtrip("a == b == (c == d)\n");
+    test_formatter_roundtrip("(let a = b) == c\n");
+    test_formatter_roundtrip("a == let b = c\n");
+}
+
 TEST_CASE("format_binary_expression_literal")
 {
     test_formatter_roundtrip("==\n");
@@ -0,0 +1,167 @@
+#include "lpg2/incremental.h"
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+namespace
+{
+    [[nodiscard]] std::string apply(std::string source, lpg::syntax::text_edit const &edit)
+    {
+        return source.replace(edit.offset, edit.removed_length, edit.inserted);
+    }
+
+    void check_tokens_match(lpg::syntax::token_buffer const &got, std::string_view const source)
+    {
+        lpg::syntax::token_buffer const expected = lpg::syntax::tokenize_all(source);
+        CHECK(expected.kinds == got.kinds);
+        CHECK(expected.offsets == got.offsets);
+        CHECK(expected.lengths == got.lengths);
+        REQUIRE(expected.symbol_ids.size() == got.symbol_ids.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            if (expected.kinds[i] == lpg::syntax::token_kind::identifier)
+            {
+                CHECK(expected.symbols.name(expected.symbol_ids[i]) == got.symbols.name(got.symbol_ids[i]));
+            }
+        }
+        CHECK(expected.end_offset == got.end_offset);
+        CHECK(expected.has_failed == got.has_failed);
+    }
+
+    // Symbol ids depend on the order of interning, so the trees are compared in their printed form unless the edit adds
+    // no names.
+    void check_edit_matches_compile(std::string const &source, lpg::syntax::text_edit const &edit,
+                                    bool const has_same_symbols = false)
+    {
+        std::vector<lpg::syntax::parse_error> ignored;
+        lpg::syntax::parsed_source previous =
+            lpg::syntax::parse_source(source, [&ignored](lpg::syntax::parse_error error) {
+                ignored.emplace_back(std::move(error));
+            });
+        std::string const edited = apply(source, edit);
+        std::vector<lpg::syntax::parse_error> got_errors;
+        lpg::syntax::parsed_source const got =
+            lpg::syntax::apply_edit(std::move(previous), edited, edit, [&got_errors](lpg::syntax::parse_error error) {
+                got_errors.emplace_back(std::move(error));
+            });
+        std::vector<lpg::syntax::parse_error> expected_errors;
+        lpg::syntax::sequence const expected =
+            lpg::syntax::compile(edited, [&expected_errors](lpg::syntax::parse_error error) {
+                expected_errors.emplace_back(std::move(error));
+            });
+        CHECK(lpg::format(expected) == lpg::format(got.parsed));
+        CHECK(expected.location == got.parsed.location);
+        if (has_same_symbols)
+        {
+            CHECK(expected == got.parsed);
+        }
+        CHECK(expected_errors == got_errors);
+        CHECK(got.has_errors == !expected_errors.empty());
+        check_tokens_match(got.tokens, edited);
+    }
+} // namespace
+
+TEST_CASE("relex_only_the_edited_token")
+{
+    std::string const source = "let a = b\nprint(a)\nprint(b)";
+    lpg::syntax::token_buffer tokens = lpg::syntax::tokenize_all(source);
+    lpg::syntax::text_edit const edit{10, 5, "write"};
+    std::string const edited = apply(source, edit);
+    lpg::syntax::token_edit const changed = lpg::syntax::relex(tokens, edited, edit);
+    CHECK(changed.first == 4);
+    CHECK(changed.removed == std::vector<lpg::syntax::token_kind>{lpg::syntax::token_kind::identifier});
+    CHECK(changed.inserted == 1);
+    check_tokens_match(tokens, edited);
+}
+
+TEST_CASE("relex_extends_the_token_in_front")
+{
+    std::string const source = "ab c";
+    lpg::syntax::token_buffer tokens = lpg::syntax::tokenize_all(source);
+    lpg::syntax::text_edit const edit{2, 1, ""};
+    std::string const edited = apply(source, edit);
+    lpg::syntax::token_edit const changed = lpg::syntax::relex(tokens, edited, edit);
+    CHECK(changed.first == 0);
+    CHECK(changed.removed.size() == 2);
+    CHECK(changed.inserted == 1);
+    check_tokens_match(tokens, edited);
+}
+
+TEST_CASE("relex_opened_string_literal")
+{
+    std::string const source = "a b \"c\" d";
+    lpg::syntax::token_buffer tokens = lpg::syntax::tokenize_all(source);
+    lpg::syntax::text_edit const edit{2, 0, "\""};
+    std::string const edited = apply(source, edit);
+    (void)lpg::syntax::relex(tokens, edited, edit);
+    check_tokens_match(tokens, edited);
+}
+
+TEST_CASE("apply_edit_inside_block")
+{
+    check_edit_matches_compile("let a = {\n    print(\"x\")\n}\nprint(a)", lpg::syntax::text_edit{20, 1, "yz"});
+}
+
+TEST_CASE("apply_edit_whitespace_only")
+{
+    check_edit_matches_compile("let a = {\n    print(\"x\")\n}\nprint(a)", lpg::syntax::text_edit{9, 1, "\n\n"});
+}
+
+TEST_CASE("apply_edit_at_the_beginning")
+{
+    // the top-level sequence stays at offset 0 because it does not begin with a token
+    check_edit_matches_compile("print(a)\n{ print(b) }", lpg::syntax::text_edit{0, 0, " "}, true);
+    check_edit_matches_compile(" print(a)\n{ print(b) }", lpg::syntax::text_edit{0, 1, ""}, true);
+    check_edit_matches_compile("{ print(a) }", lpg::syntax::text_edit{0, 0, "\n"}, true);
+    check_edit_matches_compile("\n{ print(a) }", lpg::syntax::text_edit{0, 1, ""}, true);
+    check_edit_matches_compile("\n{ print(a) }", lpg::syntax::text_edit{0, 1, "print(a) "}, true);
+}
+
+TEST_CASE("apply_edit_adding_brace")
+{
+    check_edit_matches_compile("{ print(a) }", lpg::syntax::text_edit{1, 0, "{"});
+}
+
+TEST_CASE("apply_edit_introducing_error")
+{
+    check_edit_matches_compile("{ print(a) }\nprint(b)", lpg::syntax::text_edit{8, 1, ""});
+}
+
+TEST_CASE("apply_edit_near_max_depth")
+{
+    // every level puts a block, a declaration, the right side of an operator, a call and parentheses on the stack
+    std::string source = "print(f(a))\n";
+    size_t const levels = (lpg::syntax::default_max_depth / 5) - 1;
+    for (size_t i = 0; i < levels; ++i)
+    {
+        source += "let a = b == f(({ ";
+    }
+    std::uint32_t const inner = static_cast<std::uint32_t>(source.size());
+    source += "x";
+    for (size_t i = 0; i < levels; ++i)
+    {
+        source += " }))";
+    }
+    check_edit_matches_compile(source, lpg::syntax::text_edit{inner, 1, "((((x))))"});
+    check_edit_matches_compile(source, lpg::syntax::text_edit{inner, 1, "(((((x)))))"});
+}
+
+TEST_CASE("apply_edit_random")
+{
+    std::array<std::string_view, 12> const fragments = {"a", "let", " ", "\n", "\"", "//",
+                                                        "(", ")",   "=", "{",  "}",  ","};
+    std::string const source = "let a = {\n    let b = \"x\"\n    print(b)\n    {\n        print(a == b)\n    }\n}\n"
+                               "// comment\nprint(a)\nlet c = {print(\"y\")}\n";
+    std::mt19937 generator(123);
+    std::uniform_int_distribution<std::uint32_t> pick_offset(0, static_cast<std::uint32_t>(source.size()));
+    std::uniform_int_distribution<std::uint32_t> pick_length(0, 3);
+    std::uniform_int_distribution<size_t> pick_fragment(0, fragments.size() - 1);
+    for (size_t i = 0; i < 300; ++i)
+    {
+        std::uint32_t const offset = pick_offset(generator);
+        std::uint32_t const removed =
+            std::min(pick_length(generator), static_cast<std::uint32_t>(source.size()) - offset);
+        std::string_view const inserted = (i % 4 == 0) ? std::string_view() : fragments[pick_fragment(generator)];
+        check_edit_matches_compile(source, lpg::syntax::text_edit{offset, removed, inserted});
+    }
+}
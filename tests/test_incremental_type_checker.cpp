@@ -0,0 +1,185 @@
+#include "lpg2/incremental.h"
+#include "lpg2/incremental_type_checker.h"
+#include <catch2/catch_test_macros.hpp>
+#include <list>
+#include <random>
+
+namespace
+{
+    struct incremental_session
+    {
+        // the trees point into the sources
+        std::list<std::string> sources;
+        lpg::syntax::parsed_source parsed;
+        lpg::semantics::checked_source checked;
+
+        explicit incremental_session(std::string source)
+            : sources{std::move(source)}
+            , parsed(lpg::syntax::parse_source(sources.back(), [](lpg::syntax::parse_error const &) {
+            }))
+        {
+            std::vector<lpg::semantics::semantic_error> errors;
+            checked = lpg::semantics::check_source(parsed.parsed, [&errors](lpg::semantics::semantic_error error) {
+                errors.emplace_back(std::move(error));
+            });
+            check_matches_full(errors);
+        }
+
+        void edit(lpg::syntax::text_edit const &change)
+        {
+            std::string edited = sources.back();
+            edited.replace(change.offset, change.removed_length, change.inserted);
+            sources.emplace_back(std::move(edited));
+            parsed = lpg::syntax::apply_edit(
+                std::move(parsed), sources.back(), change, [](lpg::syntax::parse_error const &) {
+                });
+            std::vector<lpg::semantics::semantic_error> errors;
+            checked = lpg::semantics::check_again(
+                std::move(checked), parsed.parsed, [&errors](lpg::semantics::semantic_error error) {
+                    errors.emplace_back(std::move(error));
+                });
+            check_matches_full(errors);
+        }
+
+        void check_matches_full(std::vector<lpg::semantics::semantic_error> const &got_errors) const
+        {
+            std::vector<lpg::semantics::semantic_error> expected_errors;
+            lpg::semantics::sequence const expected =
+                lpg::semantics::check_types(parsed.parsed, [&expected_errors](lpg::semantics::semantic_error error) {
+                    expected_errors.emplace_back(std::move(error));
+                });
+            CHECK(expected == checked.checked);
+            CHECK(expected_errors == got_errors);
+            CHECK(checked.elements.size() == parsed.parsed.elements.size());
+        }
+    };
+
+    [[nodiscard]] std::string make_statement(std::mt19937 &random)
+    {
+        auto const name = [&random](char const prefix) {
+            return std::string(1, prefix) +
+                   static_cast<char>('a' + std::uniform_int_distribution<int>(0, 5)(random));
+        };
+        switch (std::uniform_int_distribution<int>(0, 6)(random))
+        {
+        case 0:
+            return "let " + name('x') + " = \"s\"\n";
+        case 1:
+            return "print(" + name('x') + ")\n";
+        case 2:
+            return "let " + name('x') + " = true == " + name('x') + "\n";
+        case 3:
+            return "{ let " + name('y') + " = " + name('x') + " print(" + name('y') + " == " + name('x') + ") }\n";
+        case 4:
+            return "let " + name('x') + " = { let y = " + name('x') + " y }\n";
+        case 5:
+            return "let " + name('x') + " = let " + name('x') + " = \"t\"\n";
+        default:
+            return "let " + name('x') + " = " + name('x') + "\n";
+        }
+    }
+} // namespace
+
+TEST_CASE("check_again_nothing")
+{
+    incremental_session session("");
+    session.edit(lpg::syntax::text_edit{0, 0, "print(\"a\")"});
+    session.edit(lpg::syntax::text_edit{0, 10, ""});
+}
+
+TEST_CASE("check_again_changed_declaration")
+{
+    incremental_session session("let a = \"a\"\nlet b = a\n{ print(b) }\nprint(a)\n");
+    // a becomes a boolean, so everything that uses it is checked again and fails
+    session.edit(lpg::syntax::text_edit{8, 3, "a == a"});
+    session.edit(lpg::syntax::text_edit{8, 6, "\"c\""});
+    // b refers to another local of the same type now
+    session.edit(lpg::syntax::text_edit{0, 0, "let c = \"c\"\n"});
+    session.edit(lpg::syntax::text_edit{32, 1, "c"});
+}
+
+TEST_CASE("check_again_declaration_appears")
+{
+    incremental_session session("{ let a = \"a\" }\nprint(a)\n");
+    // the block can not declare a anymore, and the print finds a
+    session.edit(lpg::syntax::text_edit{0, 0, "let a = \"b\"\n"});
+    session.edit(lpg::syntax::text_edit{0, 12, ""});
+}
+
+TEST_CASE("check_again_nested_declarations")
+{
+    // the first element binds both a and b, and print(b) can only be reused if b is bound again
+    incremental_session session("let a = let b = \"x\"\nprint(b)\nprint(\"1\")\n");
+    session.edit(lpg::syntax::text_edit{36, 1, "2"});
+}
+
+TEST_CASE("check_again_same_hash")
+{
+    auto const ignore = [](auto const &) {
+    };
+    lpg::syntax::sequence const before = lpg::syntax::compile("print(\"a\")", ignore);
+    lpg::syntax::sequence after = lpg::syntax::compile(" print(\"b\")", ignore);
+    // a collision of the hashes must not make the changed element look unchanged
+    after.elements[0].hash = before.elements[0].hash;
+    lpg::semantics::checked_source const checked =
+        lpg::semantics::check_again(lpg::semantics::check_source(before, ignore), after, ignore);
+    CHECK(lpg::semantics::check_types(after, ignore) == checked.checked);
+}
+
+TEST_CASE("encode_ignores_locations")
+{
+    auto const ignore = [](auto const &) {
+    };
+    auto const encode = [&ignore](std::string_view const source) {
+        std::string result;
+        for (lpg::syntax::expression const &element : lpg::syntax::compile(source, ignore).elements)
+        {
+            lpg::semantics::encode(element, result);
+        }
+        return result;
+    };
+    CHECK(encode("let a = f(\"x\", b == c)") == encode("let  a=f( \"x\",b==c )"));
+    CHECK(encode("let a = f(\"x\", b == c)") != encode("let a = f(\"y\", b == c)"));
+    CHECK(encode("f(g)(h)") != encode("f(g(h))"));
+    CHECK(encode("{ a b }") != encode("{ a } b"));
+}
+
+TEST_CASE("check_again_random")
+{
+    std::mt19937 random(7);
+    for (size_t program = 0; program < 20; ++program)
+    {
+        std::vector<std::string> lines;
+        for (size_t i = 0; i < 30; ++i)
+        {
+            lines.emplace_back(make_statement(random));
+        }
+        std::string source;
+        for (std::string const &line : lines)
+        {
+            source += line;
+        }
+        incremental_session session(source);
+        for (size_t edit = 0; edit < 30; ++edit)
+        {
+            size_t const line = std::uniform_int_distribution<size_t>(0, lines.size())(random);
+            std::uint32_t offset = 0;
+            for (size_t i = 0; i < line; ++i)
+            {
+                offset += static_cast<std::uint32_t>(lines[i].size());
+            }
+            std::string const inserted = make_statement(random);
+            if ((line == lines.size()) || (std::uniform_int_distribution<int>(0, 2)(random) == 0))
+            {
+                lines.insert(lines.begin() + static_cast<std::ptrdiff_t>(line), inserted);
+                session.edit(lpg::syntax::text_edit{offset, 0, inserted});
+            }
+            else
+            {
+                std::uint32_t const removed = static_cast<std::uint32_t>(lines[line].size());
+                lines[line] = inserted;
+                session.edit(lpg::syntax::text_edit{offset, removed, inserted});
+            }
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "lpg2/interpreter.h"
 #include <catch2/catch_test_macros.hpp>
+#include <memory_resource>
 
 namespace
 {
@@ -12,6 +13,21 @@ namespace
     {
         FAIL(result);
     }
+
+    // Makes every allocation that falls back to the default memory_resource throw std::bad_alloc.
+    struct forbid_default_resource
+    {
+        std::pmr::memory_resource *const previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+
+        forbid_default_resource() = default;
+        forbid_default_resource(forbid_default_resource const &) = delete;
+        forbid_default_resource &operator=(forbid_default_resource const &) = delete;
+
+        ~forbid_default_resource()
+        {
+            std::pmr::set_default_resource(previous);
+        }
+    };
 } // namespace
 
 TEST_CASE("print_run_result")
@@ -157,3 +173,25 @@ let b = equals("a", "b")
 )",
                                           fail_on_parse_error, fail_on_semantic_error));
 }
+
+TEST_CASE("run_allocates_from_the_resource")
+{
+    std::pmr::monotonic_buffer_resource arena;
+    lpg::run_result result{""};
+    // the string is too long for the small string optimization
+    {
+        forbid_default_resource const forbidden;
+        result = lpg::run(R"aaa(let a = "Hello from the arena"
+let b = {
+    print(a)
+    a
+}
+print(b)
+let c = (a == b)
+let d = ==
+let e = d(a, b)
+)aaa",
+                          fail_on_parse_error, fail_on_semantic_error, &arena);
+    }
+    CHECK(lpg::run_result{"Hello from the arenaHello from the arena"} == result);
+}
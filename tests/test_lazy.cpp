@@ -0,0 +1,171 @@
+#include "lpg2/lazy.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+namespace
+{
+    [[nodiscard]] std::function<void(lpg::syntax::parse_error)> collect(std::vector<lpg::syntax::parse_error> &into)
+    {
+        return [&into](lpg::syntax::parse_error error) {
+            into.emplace_back(std::move(error));
+        };
+    }
+
+    void check_expand_all_matches_compile(std::string_view const source)
+    {
+        std::vector<lpg::syntax::parse_error> expected_errors;
+        lpg::syntax::sequence const expected = lpg::syntax::compile(source, collect(expected_errors));
+        REQUIRE(expected_errors.empty());
+        std::vector<lpg::syntax::parse_error> errors;
+        lpg::syntax::lazy_source lazy = lpg::syntax::preparse(source, collect(errors));
+        lpg::syntax::expand_all(lazy, collect(errors));
+        CHECK(errors.empty());
+        CHECK(lazy.unexpanded.empty());
+        CHECK(lazy.parsed == expected);
+    }
+
+    [[nodiscard]] lpg::syntax::sequence &get_block(lpg::syntax::expression &element)
+    {
+        return std::get<lpg::syntax::sequence>(element.value);
+    }
+} // namespace
+
+TEST_CASE("index_braces")
+{
+    lpg::syntax::token_buffer const tokens = lpg::syntax::tokenize_all("} { a { } ( } ) {");
+    lpg::syntax::brace_index const index = lpg::syntax::index_braces(tokens);
+    std::uint32_t const unmatched = lpg::syntax::brace_index::unmatched;
+    CHECK(index.matching == std::vector<std::uint32_t>{unmatched, 6, unmatched, 4, 3, unmatched, 1, unmatched,
+                                                        unmatched});
+}
+
+TEST_CASE("index_braces_every_kernel")
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> pick(0, 5);
+    std::string source;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        static constexpr std::array<std::string_view, 6> fragments = {"{", "}", "a ", "(", "{{", "}}"};
+        source += fragments[static_cast<size_t>(pick(generator))];
+    }
+    lpg::syntax::token_buffer const tokens = lpg::syntax::tokenize_all(source);
+    std::vector<std::uint32_t> expected(tokens.size(), lpg::syntax::brace_index::unmatched);
+    std::vector<std::uint32_t> open;
+    for (std::uint32_t i = 0; i < tokens.size(); ++i)
+    {
+        if (tokens.kinds[i] == lpg::syntax::token_kind::left_brace)
+        {
+            open.emplace_back(i);
+        }
+        else if ((tokens.kinds[i] == lpg::syntax::token_kind::right_brace) && !open.empty())
+        {
+            expected[i] = open.back();
+            expected[open.back()] = i;
+            open.pop_back();
+        }
+    }
+    for (lpg::simd::instruction_set const which :
+         {lpg::simd::instruction_set::scalar, lpg::simd::instruction_set::sse2, lpg::simd::instruction_set::avx2})
+    {
+        if (lpg::simd::is_supported(which))
+        {
+            CHECK(lpg::syntax::index_braces(tokens, lpg::simd::get_kernels(which)).matching == expected);
+        }
+    }
+}
+
+TEST_CASE("preparse_leaves_blocks_empty")
+{
+    std::vector<lpg::syntax::parse_error> errors;
+    lpg::syntax::lazy_source lazy =
+        lpg::syntax::preparse("let a = {\n    print(b)\n    { ) }\n}\nprint(a)\n", collect(errors));
+    CHECK(errors.empty());
+    REQUIRE(lazy.parsed.elements.size() == 2);
+    CHECK(lazy.unexpanded.size() == 1);
+    lpg::syntax::sequence &outer =
+        get_block(*std::get<lpg::syntax::declaration>(lazy.parsed.elements[0].value).initializer);
+    CHECK(outer.elements.empty());
+
+    lpg::syntax::expand(lazy, outer, collect(errors));
+    CHECK(errors.empty());
+    REQUIRE(outer.elements.size() == 2);
+    CHECK(std::holds_alternative<lpg::syntax::call>(outer.elements[0].value));
+    CHECK(get_block(outer.elements[1]).elements.empty());
+    CHECK(lazy.unexpanded.size() == 1);
+
+    // the error in the inner block shows up when it is needed
+    lpg::syntax::expand(lazy, get_block(outer.elements[1]), collect(errors));
+    CHECK(errors.size() == 1);
+    CHECK(lazy.unexpanded.empty());
+
+    // expanding again changes nothing
+    lpg::syntax::expand(lazy, outer, collect(errors));
+    lpg::syntax::expand(lazy, get_block(outer.elements[1]), collect(errors));
+    CHECK(errors.size() == 1);
+    CHECK(outer.elements.size() == 2);
+}
+
+TEST_CASE("expand_updates_hashes")
+{
+    std::string_view const source = "print(a == {\n    let b = {c}\n    b\n})\n";
+    std::vector<lpg::syntax::parse_error> errors;
+    lpg::syntax::lazy_source lazy = lpg::syntax::preparse(source, collect(errors));
+    lpg::syntax::expression &argument = *std::get<lpg::syntax::call>(lazy.parsed.elements[0].value).arguments[0];
+    lpg::syntax::sequence &outer = get_block(*std::get<lpg::syntax::binary_operator_expression>(argument.value).right);
+    lpg::syntax::expand(lazy, outer, collect(errors));
+    lpg::syntax::expand(lazy, get_block(*std::get<lpg::syntax::declaration>(outer.elements[0].value).initializer),
+                        collect(errors));
+    CHECK(errors.empty());
+    CHECK(lazy.unexpanded.empty());
+    lpg::syntax::sequence const expected = lpg::syntax::compile(source, collect(errors));
+    CHECK(lpg::syntax::get_hash(lazy.parsed) == lpg::syntax::get_hash(expected));
+    CHECK(lazy.parsed == expected);
+}
+
+TEST_CASE("expand_all_matches_compile")
+{
+    check_expand_all_matches_compile("");
+    check_expand_all_matches_compile("{}");
+    check_expand_all_matches_compile("{a}\n{{b}}");
+    check_expand_all_matches_compile("let a = {\n    let b = {\"c\"}\n    print(b == {b})\n}\nf({a}, {})\n");
+    check_expand_all_matches_compile("// {\n{ // }\n a }");
+    std::string large;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        large += "let a = {\n    print(\"b\" == {c})\n    { { d } }\n}\n";
+    }
+    check_expand_all_matches_compile(large);
+}
+
+TEST_CASE("preparse_unmatched_brace")
+{
+    std::string_view const source = "print(a)\n{ print(b)\n";
+    std::vector<lpg::syntax::parse_error> expected_errors;
+    lpg::syntax::sequence const expected = lpg::syntax::compile(source, collect(expected_errors));
+    std::vector<lpg::syntax::parse_error> errors;
+    lpg::syntax::lazy_source const lazy = lpg::syntax::preparse(source, collect(errors));
+    CHECK(lazy.parsed == expected);
+    CHECK(errors == expected_errors);
+    CHECK(lazy.unexpanded.empty());
+}
+
+TEST_CASE("expand_nesting_too_deep")
+{
+    std::string source;
+    for (size_t i = 0; i < 10'000; ++i)
+    {
+        source += "{";
+    }
+    for (size_t i = 0; i < 10'000; ++i)
+    {
+        source += "}";
+    }
+    std::vector<lpg::syntax::parse_error> errors;
+    lpg::syntax::lazy_source lazy = lpg::syntax::preparse(source, collect(errors), 100);
+    CHECK(errors.empty());
+    lpg::syntax::expand_all(lazy, collect(errors));
+    REQUIRE(errors.size() == 1);
+    CHECK(errors[0].error_message == "Nesting is too deep");
+    CHECK(errors[0].where == lpg::syntax::source_location{99});
+}
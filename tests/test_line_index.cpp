@@ -0,0 +1,54 @@
+#include "lpg2/line_index.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("line_index_empty_source")
+{
+    lpg::syntax::line_index index{""};
+    CHECK(index.line_beginnings.empty());
+    CHECK(lpg::syntax::line_and_column{0, 0} == index.locate(lpg::syntax::source_location{0}));
+}
+
+TEST_CASE("line_index_is_built_lazily")
+{
+    lpg::syntax::line_index index{"a\nb"};
+    CHECK(index.line_beginnings.empty());
+    CHECK(lpg::syntax::line_and_column{1, 0} == index.locate(lpg::syntax::source_location{2}));
+    CHECK(index.line_beginnings == std::vector<std::uint32_t>{0, 2});
+}
+
+TEST_CASE("line_index_locate")
+{
+    std::string source;
+    for (size_t line = 0; line < 100; ++line)
+    {
+        source += std::string(line, ' ') + "\n";
+    }
+    lpg::syntax::line_index index{source};
+    std::uint32_t offset = 0;
+    for (size_t line = 0; line < 100; ++line)
+    {
+        for (size_t column = 0; column <= line; ++column)
+        {
+            CHECK(lpg::syntax::line_and_column{line, column} == index.locate(lpg::syntax::source_location{offset}));
+            ++offset;
+        }
+    }
+    CHECK(lpg::syntax::line_and_column{100, 0} == index.locate(lpg::syntax::source_location{offset}));
+}
+
+TEST_CASE("line_index_counts_code_points")
+{
+    lpg::syntax::line_index index{"a\n\"\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80\" b"};
+    CHECK(lpg::syntax::line_and_column{1, 1} == index.locate(lpg::syntax::source_location{3}));
+    CHECK(lpg::syntax::line_and_column{1, 2} == index.locate(lpg::syntax::source_location{5}));
+    CHECK(lpg::syntax::line_and_column{1, 3} == index.locate(lpg::syntax::source_location{8}));
+    CHECK(lpg::syntax::line_and_column{1, 4} == index.locate(lpg::syntax::source_location{12}));
+    CHECK(lpg::syntax::line_and_column{1, 6} == index.locate(lpg::syntax::source_location{14}));
+}
+
+TEST_CASE("print_line_and_column")
+{
+    std::ostringstream s;
+    s << lpg::syntax::line_and_column{1, 2};
+    CHECK(s.str() == "2:3");
+}
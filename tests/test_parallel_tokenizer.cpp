@@ -0,0 +1,99 @@
+#include "lpg2/parallel_tokenizer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <array>
+#include <random>
+
+namespace
+{
+    void check_parallel_matches_serial(std::string_view const source)
+    {
+        lpg::syntax::token_buffer const expected = lpg::syntax::tokenize_all(source);
+        for (size_t chunk_count = 0; chunk_count <= (source.size() + 2); ++chunk_count)
+        {
+            lpg::syntax::token_buffer const got =
+                lpg::syntax::tokenize_parallel(source, chunk_count, lpg::simd::best_kernels());
+            CHECK(expected.kinds == got.kinds);
+            CHECK(expected.offsets == got.offsets);
+            CHECK(expected.lengths == got.lengths);
+            CHECK(expected.symbol_ids == got.symbol_ids);
+            REQUIRE(expected.symbols.size() == got.symbols.size());
+            for (std::uint32_t i = 0; i < expected.symbols.size(); ++i)
+            {
+                CHECK(expected.symbols.name(lpg::syntax::symbol_id{i}) == got.symbols.name(lpg::syntax::symbol_id{i}));
+            }
+            CHECK(expected.end_offset == got.end_offset);
+            CHECK(expected.has_failed == got.has_failed);
+            CHECK(expected.has_invalid_utf8 == got.has_invalid_utf8);
+        }
+    }
+} // namespace
+
+TEST_CASE("tokenize_parallel_nothing")
+{
+    check_parallel_matches_serial("");
+    check_parallel_matches_serial("\n\n\n");
+}
+
+TEST_CASE("tokenize_parallel_lines")
+{
+    check_parallel_matches_serial("let a = \"b\"\nprint(a)\n//comment \"\n{f(true, false)}\n/\n/\n==\n=");
+}
+
+TEST_CASE("tokenize_parallel_multi_line_string_literals")
+{
+    check_parallel_matches_serial("a\n\"b\nc\nd\"\ne\n\"f\n\"\"\ng\"\nh");
+    check_parallel_matches_serial("\"\n\n\n\n\"a\n\"\n\"");
+}
+
+TEST_CASE("tokenize_parallel_unterminated_string_literal")
+{
+    check_parallel_matches_serial("a\nb\n\"c\nd\ne\n");
+    check_parallel_matches_serial("a\n\"b\"\n\"c\nd\n");
+}
+
+TEST_CASE("tokenize_parallel_invalid_character")
+{
+    check_parallel_matches_serial("a\nb\n+\nc\nd\n");
+    check_parallel_matches_serial("a\n\"b\n+\"\nc\n+\nd");
+}
+
+TEST_CASE("tokenize_parallel_invalid_utf8")
+{
+    check_parallel_matches_serial("a\n\"\xc3\xa4\n\xff\"\nb\n");
+    check_parallel_matches_serial("a\n//\xc3\xa4\xc3\nb\n\"\n\"");
+    check_parallel_matches_serial("a\n\"\n\xe2\x82\xac\n\"\n//\xe2\x82\xac\n");
+}
+
+TEST_CASE("tokenize_parallel_random")
+{
+    std::array<std::string_view, 13> const fragments = {"a", "let", " ", "\n",   "\"",       "//",  "(",
+                                                        "=", "==",  "b", "\n\n", "\xc3\xa4", "\xc3"};
+    std::mt19937 generator(123);
+    std::uniform_int_distribution<size_t> pick(0, fragments.size() - 1);
+    for (size_t i = 0; i < 50; ++i)
+    {
+        std::string source;
+        for (size_t k = 0; k < 40; ++k)
+        {
+            source += fragments[pick(generator)];
+        }
+        check_parallel_matches_serial(source);
+    }
+}
+
+TEST_CASE("tokenize_parallel_default_chunking")
+{
+    std::string source;
+    while (source.size() < (3 * lpg::syntax::minimum_parallel_chunk_size))
+    {
+        source += "let a = \"Hello,\nworld!\" // comment\nprint(a)\n";
+    }
+    lpg::syntax::token_buffer const expected = lpg::syntax::tokenize_all(source);
+    lpg::syntax::token_buffer const got = lpg::syntax::tokenize_parallel(source);
+    CHECK(expected.kinds == got.kinds);
+    CHECK(expected.offsets == got.offsets);
+    CHECK(expected.lengths == got.lengths);
+    CHECK(expected.symbol_ids == got.symbol_ids);
+    CHECK(expected.end_offset == got.end_offset);
+    CHECK(expected.has_failed == got.has_failed);
+}
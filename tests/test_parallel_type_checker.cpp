@@ -0,0 +1,126 @@
+#include "lpg2/parallel_type_checker.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+namespace
+{
+    void check_parallel_matches_serial(std::string_view const source)
+    {
+        lpg::syntax::line_index lines(source);
+        lpg::syntax::flat_tree const input =
+            lpg::syntax::flatten(lpg::syntax::compile(source, [&lines](lpg::syntax::parse_error const &error) {
+                FAIL(format(error, lines));
+            }));
+        std::vector<lpg::semantics::semantic_error> expected_errors;
+        lpg::semantics::sequence const expected =
+            lpg::semantics::check_types(input, [&expected_errors](lpg::semantics::semantic_error error) {
+                expected_errors.emplace_back(std::move(error));
+            });
+        for (size_t thread_count = 1; thread_count <= 4; ++thread_count)
+        {
+            for (size_t const minimum_block_size : {size_t{1}, size_t{8}, lpg::semantics::minimum_parallel_block_size})
+            {
+                std::vector<lpg::semantics::semantic_error> got_errors;
+                lpg::semantics::sequence const got = lpg::semantics::check_types_parallel(
+                    input,
+                    [&got_errors](lpg::semantics::semantic_error error) {
+                        got_errors.emplace_back(std::move(error));
+                    },
+                    thread_count, minimum_block_size);
+                CHECK(expected == got);
+                CHECK(expected_errors == got_errors);
+            }
+        }
+    }
+
+    // identifiers consist of letters only
+    [[nodiscard]] std::string make_name(char const prefix, size_t const number)
+    {
+        std::string result(1, prefix);
+        for (size_t rest = number; rest > 0; rest /= 26)
+        {
+            result += static_cast<char>('a' + (rest % 26));
+        }
+        return result;
+    }
+} // namespace
+
+TEST_CASE("check_types_parallel_nothing")
+{
+    check_parallel_matches_serial("");
+    check_parallel_matches_serial("{}");
+    check_parallel_matches_serial("{}\n{}");
+}
+
+TEST_CASE("check_types_parallel_blocks")
+{
+    check_parallel_matches_serial(R"aaa(let a = "a"
+{
+    let b = a
+    print(b)
+}
+let c = a == "c"
+{ print(a) print(d) }
+let d = "d"
+{ let d = "e" let a = d }
+{ { let e = print e(a) } let e = d }
+)aaa");
+}
+
+TEST_CASE("check_types_parallel_random")
+{
+    std::mt19937 random(42);
+    for (size_t program = 0; program < 20; ++program)
+    {
+        std::string source;
+        size_t declared = 0;
+        for (size_t statement = 0; statement < 60; ++statement)
+        {
+            switch (std::uniform_int_distribution<int>(0, 4)(random))
+            {
+            case 0:
+                source += "let " + make_name('x', declared++) + " = \"s\"\n";
+                break;
+            case 1:
+                // may name a variable that is declared later
+                source += "print(" + make_name('x', std::uniform_int_distribution<size_t>(0, declared + 2)(random)) +
+                          ")\n";
+                break;
+            case 2: {
+                std::string const compared = make_name('x', std::uniform_int_distribution<size_t>(0, declared)(random));
+                source += "let " + make_name('x', declared++) + " = true == " + compared + "\n";
+                break;
+            }
+            default: {
+                source += "{\n";
+                size_t const length = std::uniform_int_distribution<size_t>(0, 10)(random);
+                for (size_t line = 0; line < length; ++line)
+                {
+                    std::string const outer =
+                        make_name('x', std::uniform_int_distribution<size_t>(0, declared + 2)(random));
+                    std::string const inner = make_name('y', std::uniform_int_distribution<size_t>(0, 3)(random));
+                    switch (std::uniform_int_distribution<int>(0, 3)(random))
+                    {
+                    case 0:
+                        source += "let " + inner + " = " + outer + "\n";
+                        break;
+                    case 1:
+                        source += "print(" + inner + " == " + outer + ")\n";
+                        break;
+                    case 2:
+                        // redeclares an outer name if it exists
+                        source += "let " + outer + " = \"t\"\n";
+                        break;
+                    default:
+                        source += "{ let " + inner + " = " + outer + " print(" + inner + ") }\n";
+                        break;
+                    }
+                }
+                source += "}\n";
+                break;
+            }
+            }
+        }
+        check_parallel_matches_serial(source);
+    }
+}
@@ -1,6 +1,7 @@
 #define CATCH_CONFIG_MAIN
 #include "lpg2/parser.h"
 #include <catch2/catch_test_macros.hpp>
+#include <algorithm>
 
 namespace
 {
@@ -15,39 +16,55 @@ namespace
         lpg::syntax::sequence output = lpg::syntax::compile(program, on_error);
         CHECK(expected_program == output);
         CHECK(expected_errors == error_messages);
+
+        lpg::count_errors counter;
+        CHECK(expected_program == lpg::syntax::compile(program, counter));
+        CHECK(expected_errors.size() == counter.count);
     }
+
+    struct collect_without_messages
+    {
+        static constexpr bool needs_messages = false;
+
+        std::vector<lpg::syntax::parse_error> &errors;
+
+        void operator()(lpg::syntax::parse_error error)
+        {
+            errors.emplace_back(std::move(error));
+        }
+    };
 } // namespace
 
 TEST_CASE("block_missing_closing_brace")
 {
-    std::vector<lpg::syntax::expression> block;
-    block.emplace_back(lpg::syntax::expression{lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}}});
+    std::pmr::vector<lpg::syntax::expression> block;
+    block.emplace_back(lpg::syntax::expression{lpg::syntax::sequence{{}, lpg::syntax::source_location{0}}});
     expect_compilation_error(
         "{",
-        {lpg::syntax::parse_error{"Missing closing brace '}' before end of file", lpg::syntax::source_location{0, 1}}},
-        lpg::syntax::sequence{std::move(block), lpg::syntax::source_location{0, 0}});
+        {lpg::syntax::parse_error{"Missing closing brace '}' before end of file", lpg::syntax::source_location{1}}},
+        lpg::syntax::sequence{std::move(block), lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("invalid_string_position")
 {
     expect_compilation_error(R"(let a "Hello world")",
-                             {lpg::syntax::parse_error{"Expected something else", lpg::syntax::source_location{0, 6}}},
-                             lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+                             {lpg::syntax::parse_error{"Expected something else", lpg::syntax::source_location{6}}},
+                             lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("only_let")
 {
     expect_compilation_error(
         "let",
-        {lpg::syntax::parse_error{"Expected identifier but got end of stream", lpg::syntax::source_location{0, 3}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        {lpg::syntax::parse_error{"Expected identifier but got end of stream", lpg::syntax::source_location{3}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("let_followed_by_non_identifier")
 {
     expect_compilation_error(
-        "let =", {lpg::syntax::parse_error{"Expected identifier", lpg::syntax::source_location{0, 4}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        "let =", {lpg::syntax::parse_error{"Expected identifier", lpg::syntax::source_location{4}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("declaration_missing_assignment")
@@ -55,92 +72,261 @@ TEST_CASE("declaration_missing_assignment")
     expect_compilation_error(
         "let a",
         {lpg::syntax::parse_error{
-            "Expected special character but got end of stream", lpg::syntax::source_location{0, 5}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+            "Expected special character but got end of stream", lpg::syntax::source_location{5}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("declaration_with_incorrect_operator")
 {
     expect_compilation_error(
         "let a )",
-        {lpg::syntax::parse_error{"Expected a different special character", lpg::syntax::source_location{0, 6}},
-         lpg::syntax::parse_error{"Expected something else", lpg::syntax::source_location{0, 6}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        {lpg::syntax::parse_error{"Expected a different special character", lpg::syntax::source_location{6}},
+         lpg::syntax::parse_error{"Expected something else", lpg::syntax::source_location{6}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("unterminated_string")
 {
     expect_compilation_error(
-        R"("Hello world)", {lpg::syntax::parse_error{"Tokenization failed", lpg::syntax::source_location{0, 0}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        R"("Hello world)", {lpg::syntax::parse_error{"Tokenization failed", lpg::syntax::source_location{0}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("mismatching_closing_parenthesis")
 {
     expect_compilation_error(
-        ")", {lpg::syntax::parse_error{"Can not have a closing parenthesis here.", lpg::syntax::source_location{0, 0}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        ")", {lpg::syntax::parse_error{"Can not have a closing parenthesis here.", lpg::syntax::source_location{0}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("only_slash")
 {
     expect_compilation_error(
-        "/", {lpg::syntax::parse_error{"Can not have a slash here.", lpg::syntax::source_location{0, 0}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        "/", {lpg::syntax::parse_error{"Can not have a slash here.", lpg::syntax::source_location{0}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("line_beginning_with_assign_operator")
 {
     expect_compilation_error(
         "=",
-        {lpg::syntax::parse_error{"Can not have an assignment operator here.", lpg::syntax::source_location{0, 0}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        {lpg::syntax::parse_error{"Can not have an assignment operator here.", lpg::syntax::source_location{0}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("identifier_followed_by_special_character")
 {
     expect_compilation_error(
         "a =",
-        {lpg::syntax::parse_error{"Can not have an assignment operator here.", lpg::syntax::source_location{0, 2}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        {lpg::syntax::parse_error{"Can not have an assignment operator here.", lpg::syntax::source_location{2}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("identifier_followed_by_slash")
 {
     expect_compilation_error(
-        "a /", {lpg::syntax::parse_error{"Can not have a slash here.", lpg::syntax::source_location{0, 2}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        "a /", {lpg::syntax::parse_error{"Can not have a slash here.", lpg::syntax::source_location{2}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("invalid_content_inside_parentheses")
 {
     expect_compilation_error(
         "(a /)",
-        {lpg::syntax::parse_error{"Can not have a slash here.", lpg::syntax::source_location{0, 3}},
-         lpg::syntax::parse_error{"Can not have a slash here.", lpg::syntax::source_location{0, 3}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        {lpg::syntax::parse_error{"Can not have a slash here.", lpg::syntax::source_location{3}},
+         lpg::syntax::parse_error{"Can not have a slash here.", lpg::syntax::source_location{3}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("parse_argument_error")
 {
     expect_compilation_error(
         "f(",
-        {lpg::syntax::parse_error{"Could not parse arguments of the function", lpg::syntax::source_location{0, 1}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        {lpg::syntax::parse_error{"Could not parse arguments of the function", lpg::syntax::source_location{1}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("missing_initializer_for_declaration")
 {
     expect_compilation_error(
         R"(let a = )",
-        {lpg::syntax::parse_error{"Unexpected end of stream", lpg::syntax::source_location{0, 8}},
-         lpg::syntax::parse_error{"Invalid initializer value for identifier: a", lpg::syntax::source_location{0, 4}}},
-        lpg::syntax::sequence{{}, lpg::syntax::source_location{0, 0}});
+        {lpg::syntax::parse_error{"Unexpected end of stream", lpg::syntax::source_location{8}},
+         lpg::syntax::parse_error{"Invalid initializer value for identifier: a", lpg::syntax::source_location{4}}},
+        lpg::syntax::sequence{{}, lpg::syntax::source_location{0}});
 }
 
 TEST_CASE("print_parse_error")
 {
     std::ostringstream s;
-    s << lpg::syntax::parse_error{"content", lpg::syntax::source_location{1, 2}};
-    CHECK(s.str() == "2:3: content");
+    s << lpg::syntax::parse_error{"content", lpg::syntax::source_location{12}};
+    CHECK(s.str() == "offset 12: content");
+}
+
+TEST_CASE("compile_type_erased_error_sink")
+{
+    std::vector<lpg::syntax::parse_error> errors;
+    std::function<void(lpg::syntax::parse_error)> const on_error = [&errors](lpg::syntax::parse_error error) {
+        errors.emplace_back(std::move(error));
+    };
+    (void)lpg::syntax::compile("let", on_error);
+    CHECK(errors == std::vector<lpg::syntax::parse_error>{lpg::syntax::parse_error{
+                        "Expected identifier but got end of stream", lpg::syntax::source_location{3}}});
+}
+
+TEST_CASE("compile_without_messages")
+{
+    std::vector<lpg::syntax::parse_error> errors;
+    (void)lpg::syntax::compile("let a = \"b", collect_without_messages{errors});
+    CHECK(errors == std::vector<lpg::syntax::parse_error>{
+                        lpg::syntax::parse_error{"", lpg::syntax::source_location{8}},
+                        lpg::syntax::parse_error{"", lpg::syntax::source_location{4}},
+                        lpg::syntax::parse_error{"", lpg::syntax::source_location{8}}});
+    lpg::discard_errors discard;
+    CHECK(lpg::syntax::compile("print(\"a\")", discard).elements.size() == 1);
+}
+
+TEST_CASE("comments_between_any_tokens")
+{
+    std::vector<lpg::syntax::parse_error> errors;
+    lpg::syntax::sequence const parsed = lpg::syntax::compile(
+        "let //a\nb //c\n= //d\n\"e\"\nprint( //f\nb //g\n) //h\n", [&errors](lpg::syntax::parse_error error) {
+            errors.emplace_back(std::move(error));
+        });
+    CHECK(errors.empty());
+    REQUIRE(parsed.elements.size() == 2);
+    CHECK(std::holds_alternative<lpg::syntax::declaration>(parsed.elements[0].value));
+    CHECK(std::holds_alternative<lpg::syntax::call>(parsed.elements[1].value));
+}
+
+TEST_CASE("nesting_too_deep")
+{
+    for (std::string_view const opening : {"(", "{", "print(", "let a = ", "a == "})
+    {
+        std::string source;
+        for (size_t i = 0; i < 100'000; ++i)
+        {
+            source += opening;
+        }
+        std::vector<lpg::syntax::parse_error> errors;
+        (void)lpg::syntax::compile(source, [&errors](lpg::syntax::parse_error error) {
+            errors.emplace_back(std::move(error));
+        });
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].error_message == "Nesting is too deep");
+    }
+}
+
+TEST_CASE("nesting_up_to_max_depth")
+{
+    size_t const depth = 100;
+    std::string source;
+    for (size_t i = 0; i < depth; ++i)
+    {
+        source += "{";
+    }
+    for (size_t i = 0; i < depth; ++i)
+    {
+        source += "}";
+    }
+    lpg::count_errors errors;
+    lpg::syntax::sequence parsed = lpg::syntax::compile(source, errors, depth + 1);
+    CHECK(errors.count == 0);
+    for (size_t i = 0; i < depth; ++i)
+    {
+        REQUIRE(parsed.elements.size() == 1);
+        lpg::syntax::sequence inner = std::get<lpg::syntax::sequence>(std::move(parsed.elements[0].value));
+        parsed = std::move(inner);
+    }
+    CHECK(parsed.elements.empty());
+    CHECK(lpg::syntax::compile(source, errors, depth).elements.empty());
+    CHECK(errors.count == 1);
+}
+
+TEST_CASE("binary_operator_table")
+{
+    REQUIRE(lpg::syntax::find_binary_operator(lpg::syntax::special_character::equals));
+    CHECK(lpg::syntax::find_binary_operator(lpg::syntax::special_character::equals)->which ==
+          lpg::syntax::binary_operator::equals);
+    CHECK(!lpg::syntax::find_binary_operator(lpg::syntax::special_character::assign));
+    CHECK(!lpg::syntax::find_binary_operator(lpg::syntax::special_character::comma));
+}
+
+TEST_CASE("binary_operator_chain_is_left_associative")
+{
+    lpg::count_errors errors;
+    lpg::syntax::sequence const parsed = lpg::syntax::compile("a == (b == c) == d", errors);
+    CHECK(errors.count == 0);
+    REQUIRE(parsed.elements.size() == 1);
+    auto const &outer = std::get<lpg::syntax::binary_operator_expression>(parsed.elements[0].value);
+    CHECK(std::get<lpg::syntax::identifier>(outer.right->value).content == "d");
+    auto const &inner = std::get<lpg::syntax::binary_operator_expression>(outer.left->value);
+    CHECK(std::get<lpg::syntax::identifier>(inner.left->value).content == "a");
+    CHECK(std::holds_alternative<lpg::syntax::binary_operator_expression>(inner.right->value));
+}
+
+TEST_CASE("long_binary_operator_chain")
+{
+    size_t const length = 5'000;
+    std::string source = "a";
+    for (size_t i = 0; i < length; ++i)
+    {
+        source += " == a";
+    }
+    lpg::count_errors errors;
+    lpg::syntax::sequence const parsed = lpg::syntax::compile(source, errors);
+    CHECK(errors.count == 0);
+    REQUIRE(parsed.elements.size() == 1);
+    lpg::syntax::expression const *left = &parsed.elements[0];
+    size_t found = 0;
+    while (auto const *const binary = std::get_if<lpg::syntax::binary_operator_expression>(&left->value))
+    {
+        CHECK(std::holds_alternative<lpg::syntax::identifier>(binary->right->value));
+        left = binary->left.get();
+        ++found;
+    }
+    CHECK(found == length);
+    (void)lpg::syntax::compile(source, errors, length);
+    CHECK(errors.count == 1);
+}
+
+TEST_CASE("tree_hash_ignores_locations")
+{
+    lpg::count_errors errors;
+    lpg::syntax::sequence const first = lpg::syntax::compile("let a = f(\"b\", c == {d})", errors);
+    lpg::syntax::sequence const moved = lpg::syntax::compile("\n\n  let a = f(\"b\",c=={ d })", errors);
+    CHECK(errors.count == 0);
+    CHECK(lpg::syntax::get_hash(first) == lpg::syntax::get_hash(moved));
+    CHECK(first.elements[0].hash == moved.elements[0].hash);
+    CHECK(first != moved);
+}
+
+TEST_CASE("tree_hash_differs")
+{
+    std::vector<std::string_view> const sources = {
+        "f(a)", "f(b)", "f(a, b)", "f(b, a)", "f()", "{f(a)}", "a == b", "b == a", "let a = b", "let b = a", "\"a\"",
+        "a",    "true", "false",   "==",      "{}",  "{{}}",   "a\nb",   "b\na",   "(a == b) == c", "a == (b == c)"};
+    std::vector<lpg::syntax::tree_hash> hashes;
+    for (std::string_view const source : sources)
+    {
+        lpg::count_errors errors;
+        lpg::syntax::sequence const parsed = lpg::syntax::compile(source, errors);
+        CHECK(errors.count == 0);
+        hashes.emplace_back(lpg::syntax::get_hash(parsed));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    CHECK(std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end());
+}
+
+TEST_CASE("update_hashes_after_replacing_a_block")
+{
+    lpg::count_errors errors;
+    lpg::syntax::sequence tree = lpg::syntax::compile("f({a})", errors);
+    lpg::syntax::sequence const expected = lpg::syntax::compile("f({b})", errors);
+    auto &block =
+        std::get<lpg::syntax::sequence>(std::get<lpg::syntax::call>(tree.elements[0].value).arguments[0]->value);
+    block = lpg::syntax::compile("   b", errors);
+    block.location = lpg::syntax::source_location{2};
+    CHECK(lpg::syntax::get_hash(tree) != lpg::syntax::get_hash(expected));
+    lpg::syntax::update_hashes(tree);
+    CHECK(lpg::syntax::get_hash(tree) == lpg::syntax::get_hash(expected));
 }
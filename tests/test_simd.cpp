@@ -0,0 +1,239 @@
+#include "lpg2/tokenizer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<lpg::simd::instruction_set> supported_instruction_sets()
+    {
+        std::vector<lpg::simd::instruction_set> result;
+        for (lpg::simd::instruction_set const candidate :
+             {lpg::simd::instruction_set::scalar, lpg::simd::instruction_set::sse2, lpg::simd::instruction_set::avx2})
+        {
+            if (lpg::simd::is_supported(candidate))
+            {
+                result.emplace_back(candidate);
+            }
+        }
+        return result;
+    }
+
+    // every interesting position in inputs of sizes around the block sizes of the kernels
+    std::vector<std::string> generate_inputs(char const filler, char const needle)
+    {
+        std::vector<std::string> result;
+        for (size_t length = 0; length <= 70; ++length)
+        {
+            result.emplace_back(length, filler);
+            for (size_t position = 0; position < length; ++position)
+            {
+                std::string input(length, filler);
+                input[position] = needle;
+                result.emplace_back(std::move(input));
+            }
+        }
+        return result;
+    }
+
+    std::vector<lpg::syntax::token> scan_all(std::string_view const source, lpg::simd::kernels const &kernels)
+    {
+        lpg::syntax::scanner s(source, kernels);
+        std::vector<lpg::syntax::token> result;
+        while (std::optional<lpg::syntax::token> t = s.pop())
+        {
+            result.emplace_back(std::move(*t));
+        }
+        CHECK(!s.has_failed);
+        return result;
+    }
+
+    // returns the offset of the first invalid sequence, or input.size()
+    size_t find_invalid_utf8(std::string_view const input, lpg::simd::kernels const &kernels)
+    {
+        return static_cast<size_t>(kernels.find_invalid_utf8(input.data(), input.data() + input.size()) -
+                                   input.data());
+    }
+} // namespace
+
+TEST_CASE("simd_scalar_is_always_supported")
+{
+    CHECK(lpg::simd::is_supported(lpg::simd::instruction_set::scalar));
+    CHECK(lpg::simd::is_supported(lpg::simd::detect_instruction_set()));
+}
+
+TEST_CASE("simd_find_quote")
+{
+    for (lpg::simd::instruction_set const which : supported_instruction_sets())
+    {
+        lpg::simd::kernels const &kernels = lpg::simd::get_kernels(which);
+        for (std::string const &input : generate_inputs('a', '"'))
+        {
+            char const *const begin = input.data();
+            char const *const end = begin + input.size();
+            CHECK(static_cast<size_t>(kernels.find_quote(begin, end) - begin) ==
+                  std::min(input.find('"'), input.size()));
+        }
+    }
+}
+
+TEST_CASE("simd_find_new_line")
+{
+    for (lpg::simd::instruction_set const which : supported_instruction_sets())
+    {
+        lpg::simd::kernels const &kernels = lpg::simd::get_kernels(which);
+        for (std::string const &input : generate_inputs('"', '\n'))
+        {
+            char const *const begin = input.data();
+            char const *const end = begin + input.size();
+            CHECK(static_cast<size_t>(kernels.find_new_line(begin, end) - begin) ==
+                  std::min(input.find('\n'), input.size()));
+        }
+    }
+}
+
+TEST_CASE("simd_find_either")
+{
+    for (lpg::simd::instruction_set const which : supported_instruction_sets())
+    {
+        lpg::simd::kernels const &kernels = lpg::simd::get_kernels(which);
+        for (char const needle : {'{', '}'})
+        {
+            for (std::string const &input : generate_inputs('a', needle))
+            {
+                char const *const begin = input.data();
+                char const *const end = begin + input.size();
+                CHECK(static_cast<size_t>(kernels.find_either(begin, end, '{', '}') - begin) ==
+                      std::min(input.find(needle), input.size()));
+            }
+        }
+    }
+}
+
+TEST_CASE("simd_skip_whitespace")
+{
+    std::vector<std::string> inputs = generate_inputs(' ', 'a');
+    for (std::string input : generate_inputs('\n', 'x'))
+    {
+        input += " \n";
+        inputs.emplace_back(std::move(input));
+    }
+    for (lpg::simd::instruction_set const which : supported_instruction_sets())
+    {
+        lpg::simd::kernels const &kernels = lpg::simd::get_kernels(which);
+        for (std::string const &input : inputs)
+        {
+            char const *const begin = input.data();
+            char const *const end = begin + input.size();
+            CHECK(static_cast<size_t>(kernels.skip_whitespace(begin, end) - begin) ==
+                  std::min(input.find_first_not_of(" \n"), input.size()));
+        }
+    }
+}
+
+TEST_CASE("simd_count_new_lines")
+{
+    for (lpg::simd::instruction_set const which : supported_instruction_sets())
+    {
+        lpg::simd::kernels const &kernels = lpg::simd::get_kernels(which);
+        for (std::string const &input : generate_inputs('\n', 'a'))
+        {
+            char const *const begin = input.data();
+            char const *const end = begin + input.size();
+            CHECK(kernels.count_new_lines(begin, end) == static_cast<size_t>(std::count(begin, end, '\n')));
+        }
+    }
+}
+
+TEST_CASE("simd_scanner_matches_scalar")
+{
+    std::string source;
+    for (size_t i = 0; i < 40; ++i)
+    {
+        source += "// a comment that is long enough to span several blocks " + std::string(i, '/') + "\n";
+        source += std::string(i, ' ') + "let a = \"" + std::string(i * 3, 'x') + "\"\n";
+        source += std::string(i, '\n') + "print(a)" + std::string(i, ' ') + "\n";
+    }
+    std::vector<lpg::syntax::token> const expected =
+        scan_all(source, lpg::simd::get_kernels(lpg::simd::instruction_set::scalar));
+    CHECK(expected.size() == 40 * 9);
+    for (lpg::simd::instruction_set const which : supported_instruction_sets())
+    {
+        CHECK(expected == scan_all(source, lpg::simd::get_kernels(which)));
+    }
+}
+
+TEST_CASE("simd_find_invalid_utf8")
+{
+    // a sequence and the offset of the first invalid byte in it
+    std::vector<std::pair<std::string, size_t>> const sequences = {
+        {"a", 1},
+        {"\xc3\xa4", 2},
+        {"\xe2\x82\xac", 3},
+        {"\xf0\x9f\x98\x80", 4},
+        {"\xf4\x8f\xbf\xbf", 4},
+        {"\x80", 0},
+        {"\xbf", 0},
+        {"\xff", 0},
+        {"\xc0\x80", 0},
+        {"\xc1\xbf", 0},
+        {"\xe0\x80\x80", 0},
+        {"\xed\xa0\x80", 0},
+        {"\xf0\x80\x80\x80", 0},
+        {"\xf4\x90\x80\x80", 0},
+        {"\xf5\x80\x80\x80", 0},
+        {"\xc3", 0},
+        {"\xe2\x82", 0},
+        {"\xf0\x9f\x98", 0},
+        {"\xc3\xa4\xa4", 2},
+    };
+    for (lpg::simd::instruction_set const which : supported_instruction_sets())
+    {
+        lpg::simd::kernels const &kernels = lpg::simd::get_kernels(which);
+        for (auto const &[sequence, invalid_at] : sequences)
+        {
+            for (size_t length = 0; length <= 70; ++length)
+            {
+                for (size_t position = 0; position <= length; ++position)
+                {
+                    std::string input(length, 'x');
+                    input.insert(position, sequence);
+                    size_t const expected = (invalid_at == sequence.size()) ? input.size() : (position + invalid_at);
+                    CHECK(find_invalid_utf8(input, kernels) == expected);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("simd_find_invalid_utf8_matches_scalar")
+{
+    lpg::simd::kernels const &scalar = lpg::simd::get_kernels(lpg::simd::instruction_set::scalar);
+    std::array<std::string_view, 8> const fragments = {"a", "\xc3\xa4", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+                                                       "\x80", "\xe2", "\xed\xa0\x80", "\n"};
+    std::mt19937 generator(123);
+    std::uniform_int_distribution<size_t> pick(0, fragments.size() - 1);
+    std::uniform_int_distribution<size_t> pick_valid(0, 3);
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        std::string input;
+        while (input.size() < 100)
+        {
+            // mostly valid input so that errors end up in every part of the blocks
+            input += fragments[(i % 10 == 0) ? pick(generator) : pick_valid(generator)];
+        }
+        if (i % 10 != 0)
+        {
+            input += fragments[pick(generator)];
+            input += std::string(i % 40, 'x');
+        }
+        size_t const expected = find_invalid_utf8(input, scalar);
+        for (lpg::simd::instruction_set const which : supported_instruction_sets())
+        {
+            CHECK(find_invalid_utf8(input, lpg::simd::get_kernels(which)) == expected);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include "lpg2/interpreter.h"
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+#include <system_error>
+
+namespace
+{
+    struct temporary_file
+    {
+        std::filesystem::path path;
+
+        temporary_file(std::string_view const name, std::string_view const content)
+            : path(std::filesystem::temp_directory_path() / name)
+        {
+            std::ofstream file(path, std::ios::binary);
+            file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        }
+
+        ~temporary_file()
+        {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+    };
+
+    void fail_on_parse_error(lpg::syntax::parse_error result)
+    {
+        FAIL(result);
+    }
+
+    void fail_on_semantic_error(lpg::semantics::semantic_error result)
+    {
+        FAIL(result);
+    }
+} // namespace
+
+TEST_CASE("source_file_content")
+{
+    temporary_file const file("lpg2_source_file_content.lpg", "print(\"Hello\")\n");
+    lpg::source_file const source(file.path);
+    CHECK(source.content() == "print(\"Hello\")\n");
+}
+
+TEST_CASE("source_file_empty")
+{
+    temporary_file const file("lpg2_source_file_empty.lpg", "");
+    lpg::source_file const source(file.path);
+    CHECK(source.content().empty());
+}
+
+TEST_CASE("source_file_large")
+{
+    // large enough to take the huge page aligned path
+    std::string const content(size_t{5} * 1024 * 1024 + 123, 'a');
+    temporary_file const file("lpg2_source_file_large.lpg", content);
+    lpg::source_file const source(file.path);
+    CHECK(source.content() == content);
+}
+
+TEST_CASE("source_file_move")
+{
+    temporary_file const file("lpg2_source_file_move.lpg", "abc");
+    lpg::source_file original(file.path);
+    std::string_view const content = original.content();
+    lpg::source_file moved = std::move(original);
+    CHECK(moved.content().data() == content.data());
+    CHECK(moved.content() == "abc");
+    lpg::source_file assigned(file.path);
+    assigned = std::move(moved);
+    CHECK(assigned.content().data() == content.data());
+}
+
+TEST_CASE("source_file_missing")
+{
+    CHECK_THROWS_AS(lpg::source_file(std::filesystem::temp_directory_path() / "lpg2_does_not_exist.lpg"),
+                    std::system_error);
+}
+
+TEST_CASE("compile_file")
+{
+    temporary_file const file("lpg2_compile_file.lpg", "print(\"Hello\")");
+    lpg::syntax::compiled_file const compiled = lpg::syntax::compile_file(file.path, fail_on_parse_error);
+    CHECK(compiled.parsed.elements.size() == 1);
+    CHECK(compiled.source.content() == "print(\"Hello\")");
+}
+
+TEST_CASE("run_file")
+{
+    temporary_file const file("lpg2_run_file.lpg", "let s = \"Hello, world!\"\nprint(s)\n");
+    CHECK(lpg::run_result{"Hello, world!"} == lpg::run_file(file.path, fail_on_parse_error, fail_on_semantic_error));
+}
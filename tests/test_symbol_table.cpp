@@ -0,0 +1,63 @@
+#include "lpg2/token_buffer.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("symbol_table_print_is_first")
+{
+    lpg::syntax::symbol_table symbols;
+    CHECK(symbols.size() == 1);
+    CHECK(symbols.name(lpg::syntax::print_symbol) == "print");
+    CHECK(symbols.intern("print") == lpg::syntax::print_symbol);
+}
+
+TEST_CASE("symbol_table_intern")
+{
+    lpg::syntax::symbol_table symbols;
+    lpg::syntax::symbol_id const a = symbols.intern("a");
+    lpg::syntax::symbol_id const b = symbols.intern("b");
+    CHECK(a == lpg::syntax::symbol_id{1});
+    CHECK(b == lpg::syntax::symbol_id{2});
+    std::string const a_again = "a";
+    CHECK(symbols.intern(a_again) == a);
+    CHECK(symbols.size() == 3);
+    CHECK(symbols.name(a) == "a");
+    CHECK(symbols.name(b) == "b");
+}
+
+TEST_CASE("symbol_table_copy")
+{
+    lpg::syntax::symbol_table original;
+    lpg::syntax::symbol_id const a = original.intern("a");
+    lpg::syntax::symbol_table copy = original;
+    original = lpg::syntax::symbol_table();
+    CHECK(copy.name(a) == "a");
+    CHECK(copy.intern("a") == a);
+    CHECK(original.size() == 1);
+    original = copy;
+    CHECK(original.name(a) == "a");
+}
+
+TEST_CASE("print_symbol_id")
+{
+    CHECK(lpg::format(lpg::syntax::symbol_id{3}) == "symbol 3");
+}
+
+TEST_CASE("scanner_interns_identifiers")
+{
+    lpg::syntax::scanner tokens("a b print a");
+    CHECK(std::get<lpg::syntax::identifier_token>(tokens.pop()->content).symbol == lpg::syntax::symbol_id{1});
+    CHECK(std::get<lpg::syntax::identifier_token>(tokens.pop()->content).symbol == lpg::syntax::symbol_id{2});
+    CHECK(std::get<lpg::syntax::identifier_token>(tokens.pop()->content).symbol == lpg::syntax::print_symbol);
+    CHECK(std::get<lpg::syntax::identifier_token>(tokens.pop()->content).symbol == lpg::syntax::symbol_id{1});
+    CHECK(tokens.symbols.size() == 3);
+}
+
+TEST_CASE("tokenize_all_interns_identifiers")
+{
+    lpg::syntax::token_buffer const tokens = lpg::syntax::tokenize_all("let a = b(a, print)");
+    CHECK(tokens.symbol_ids.size() == tokens.size());
+    CHECK(tokens.symbol_ids[1] == lpg::syntax::symbol_id{1});
+    CHECK(tokens.symbol_ids[3] == lpg::syntax::symbol_id{2});
+    CHECK(tokens.symbol_ids[5] == lpg::syntax::symbol_id{1});
+    CHECK(tokens.symbol_ids[7] == lpg::syntax::print_symbol);
+    CHECK(tokens.symbols.name(lpg::syntax::symbol_id{2}) == "b");
+}
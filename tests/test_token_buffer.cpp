@@ -0,0 +1,109 @@
+#include "lpg2/token_buffer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+namespace
+{
+    struct scan_result
+    {
+        std::vector<lpg::syntax::token> tokens;
+        lpg::syntax::source_location end_location;
+        bool has_failed;
+    };
+
+    template <class TokenSource>
+    scan_result scan_everything(TokenSource tokens)
+    {
+        scan_result result{{}, {}, false};
+        while (std::optional<lpg::syntax::token> t = tokens.pop())
+        {
+            result.tokens.emplace_back(std::move(*t));
+        }
+        result.end_location = tokens.next_location;
+        result.has_failed = tokens.has_failed;
+        return result;
+    }
+
+    void check_cursor_matches_scanner(std::string_view const source)
+    {
+        scan_result const expected = scan_everything(lpg::syntax::scanner{source});
+        scan_result const got = scan_everything(lpg::syntax::token_cursor{source});
+        CHECK(expected.tokens == got.tokens);
+        CHECK(expected.end_location == got.end_location);
+        CHECK(expected.has_failed == got.has_failed);
+    }
+} // namespace
+
+TEST_CASE("tokenize_all_nothing")
+{
+    lpg::syntax::token_buffer const tokens = lpg::syntax::tokenize_all("  \n ");
+    CHECK(tokens.size() == 0);
+    CHECK(tokens.end_offset == 4);
+    CHECK(!tokens.has_failed);
+}
+
+TEST_CASE("tokenize_all_kinds")
+{
+    lpg::syntax::token_buffer const tokens = lpg::syntax::tokenize_all("let a = \"b\" == true //c\n(f, {})/false");
+    CHECK(tokens.kinds ==
+          std::vector<lpg::syntax::token_kind>{
+              lpg::syntax::token_kind::keyword_let, lpg::syntax::token_kind::identifier,
+              lpg::syntax::token_kind::assign, lpg::syntax::token_kind::string_literal,
+              lpg::syntax::token_kind::equals, lpg::syntax::token_kind::keyword_true,
+              lpg::syntax::token_kind::comment, lpg::syntax::token_kind::left_parenthesis,
+              lpg::syntax::token_kind::identifier, lpg::syntax::token_kind::comma,
+              lpg::syntax::token_kind::left_brace, lpg::syntax::token_kind::right_brace,
+              lpg::syntax::token_kind::right_parenthesis, lpg::syntax::token_kind::slash,
+              lpg::syntax::token_kind::keyword_false});
+    CHECK(tokens.offsets == std::vector<std::uint32_t>{0, 4, 6, 8, 12, 15, 20, 24, 25, 26, 28, 29, 30, 31, 32});
+    CHECK(tokens.lengths == std::vector<std::uint32_t>{3, 1, 1, 3, 2, 4, 4, 1, 1, 1, 1, 1, 1, 1, 5});
+    CHECK(tokens.end_offset == 37);
+    CHECK(!tokens.has_failed);
+}
+
+TEST_CASE("tokenize_all_stops_at_invalid_character")
+{
+    lpg::syntax::token_buffer const tokens = lpg::syntax::tokenize_all("a + b");
+    CHECK(tokens.size() == 1);
+    CHECK(tokens.end_offset == 2);
+    CHECK(!tokens.has_failed);
+}
+
+TEST_CASE("tokenize_all_unterminated_string")
+{
+    lpg::syntax::token_buffer const tokens = lpg::syntax::tokenize_all("a \"b");
+    CHECK(tokens.size() == 1);
+    CHECK(tokens.end_offset == 2);
+    CHECK(tokens.has_failed);
+}
+
+TEST_CASE("tokenize_all_invalid_utf8")
+{
+    lpg::syntax::token_buffer const tokens = lpg::syntax::tokenize_all("a \"\xc3\xa4\" //b\xff");
+    CHECK(tokens.size() == 2);
+    CHECK(tokens.end_offset == 10);
+    CHECK(tokens.has_failed);
+    CHECK(tokens.has_invalid_utf8);
+}
+
+TEST_CASE("token_cursor_matches_scanner")
+{
+    check_cursor_matches_scanner("");
+    check_cursor_matches_scanner("   ");
+    check_cursor_matches_scanner("print(\"Hello\")");
+    check_cursor_matches_scanner("let a = \"multi\nline\"\n  a == a // comment\n\n{ f(a, b) }\n  ");
+    check_cursor_matches_scanner("//only a comment");
+    check_cursor_matches_scanner("a\n  +");
+    check_cursor_matches_scanner("a\n  \"unterminated");
+    check_cursor_matches_scanner("/ = == , ( ) { } true false");
+}
+
+TEST_CASE("token_cursor_fails_only_at_the_end")
+{
+    lpg::syntax::token_cursor tokens{"a \"b"};
+    CHECK(tokens.pop());
+    CHECK(!tokens.has_failed);
+    CHECK(!tokens.peek());
+    CHECK(tokens.has_failed);
+    CHECK(lpg::syntax::source_location(2) == tokens.next_location);
+}
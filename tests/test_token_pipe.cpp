@@ -0,0 +1,84 @@
+#include "lpg2/parser.h"
+#include "lpg2/token_pipe.h"
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+namespace
+{
+    void check_pipelined_matches_compile(std::string_view const source)
+    {
+        std::vector<lpg::syntax::parse_error> expected_errors;
+        lpg::syntax::sequence const expected =
+            lpg::syntax::compile(source, [&expected_errors](lpg::syntax::parse_error error) {
+                expected_errors.emplace_back(std::move(error));
+            });
+        std::vector<lpg::syntax::parse_error> got_errors;
+        lpg::syntax::sequence const got =
+            lpg::syntax::compile_pipelined(source, [&got_errors](lpg::syntax::parse_error error) {
+                got_errors.emplace_back(std::move(error));
+            });
+        CHECK(expected == got);
+        CHECK(expected_errors == got_errors);
+    }
+
+    // enough tokens for several rounds through all batches of the pipe
+    [[nodiscard]] std::string repeat(std::string_view const line)
+    {
+        std::string result;
+        while (result.size() < (3 * lpg::syntax::token_pipe::capacity * lpg::syntax::token_pipe::batch_size * 2))
+        {
+            result += line;
+        }
+        return result;
+    }
+} // namespace
+
+TEST_CASE("token_pipe_passes_all_tokens")
+{
+    std::string const source = repeat("let a = \"b\" //c\nprint(a == a)\n");
+    lpg::syntax::token_buffer const expected = lpg::syntax::tokenize_all(source);
+    lpg::syntax::token_pipe pipe;
+    std::jthread lexer([&source, &pipe]() {
+        lpg::syntax::tokenize_into(source, lpg::simd::best_kernels(), pipe);
+    });
+    lpg::syntax::token_buffer got;
+    lpg::syntax::token_buffer batch;
+    while (pipe.pop(batch))
+    {
+        CHECK(batch.size() <= lpg::syntax::token_pipe::batch_size);
+        got.kinds.insert(got.kinds.end(), batch.kinds.begin(), batch.kinds.end());
+        got.offsets.insert(got.offsets.end(), batch.offsets.begin(), batch.offsets.end());
+        got.lengths.insert(got.lengths.end(), batch.lengths.begin(), batch.lengths.end());
+        got.symbol_ids.insert(got.symbol_ids.end(), batch.symbol_ids.begin(), batch.symbol_ids.end());
+    }
+    CHECK(expected.kinds == got.kinds);
+    CHECK(expected.offsets == got.offsets);
+    CHECK(expected.lengths == got.lengths);
+    CHECK(expected.symbol_ids == got.symbol_ids);
+    CHECK(expected.end_offset == batch.end_offset);
+    CHECK(!batch.has_failed);
+}
+
+TEST_CASE("compile_pipelined_nothing")
+{
+    check_pipelined_matches_compile("");
+    check_pipelined_matches_compile(" \n");
+}
+
+TEST_CASE("compile_pipelined_errors")
+{
+    check_pipelined_matches_compile("print(\"a\")\n{ let b = \"c\"\n");
+    check_pipelined_matches_compile("print(\"a\")\n\"unterminated");
+    check_pipelined_matches_compile("a\n//\xff");
+}
+
+TEST_CASE("compile_pipelined_large")
+{
+    check_pipelined_matches_compile(repeat("let a = {\n    print(\"b\" == a)\n}\n// comment\n"));
+}
+
+TEST_CASE("compile_pipelined_parser_stops_early")
+{
+    // the parser gives up at the first token, so the lexer has to be cancelled while the pipe is full
+    check_pipelined_matches_compile(")" + repeat("print(a)\n"));
+}
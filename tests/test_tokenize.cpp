@@ -20,7 +20,7 @@ TEST_CASE("scan_peek_token")
 {
     auto s = lpg::syntax::scanner("\"Hello\"");
     lpg::syntax::token const t = s.peek().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     lpg::syntax::string_literal literal = std::get<lpg::syntax::string_literal>(t.content);
     CHECK(literal.inner_content == "Hello");
     CHECK(!s.has_failed);
@@ -30,7 +30,7 @@ TEST_CASE("scan_string")
 {
     auto s = lpg::syntax::scanner("\"Hello\"");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     lpg::syntax::string_literal const string = std::get<lpg::syntax::string_literal>(t.content);
     CHECK(string.inner_content == "Hello");
     CHECK(!s.has_failed);
@@ -43,11 +43,40 @@ TEST_CASE("scan_invalid_string")
     CHECK(s.has_failed);
 }
 
+TEST_CASE("scan_utf8_in_string_and_comment")
+{
+    auto s = lpg::syntax::scanner("\"\xc3\xa4\xe2\x82\xac\" //\xf0\x9f\x98\x80");
+    CHECK(lpg::syntax::token{lpg::syntax::string_literal{"\xc3\xa4\xe2\x82\xac"}, lpg::syntax::source_location{0}} ==
+          s.pop());
+    CHECK(lpg::syntax::token{lpg::syntax::comment{"\xf0\x9f\x98\x80"}, lpg::syntax::source_location{8}} == s.pop());
+    CHECK(std::nullopt == s.pop());
+    CHECK(!s.has_failed);
+}
+
+TEST_CASE("scan_invalid_utf8_in_string")
+{
+    auto s = lpg::syntax::scanner("a \"b\xc3(\"");
+    CHECK(lpg::syntax::token{lpg::syntax::identifier_token{"a", lpg::syntax::symbol_id{1}},
+                             lpg::syntax::source_location{0}} == s.pop());
+    CHECK(std::nullopt == s.pop());
+    CHECK(s.has_failed);
+    CHECK(s.next_location == lpg::syntax::source_location{4});
+}
+
+TEST_CASE("scan_invalid_utf8_in_comment")
+{
+    auto s = lpg::syntax::scanner("//ok\n//\xed\xa0\x80\na");
+    CHECK(lpg::syntax::token{lpg::syntax::comment{"ok\n"}, lpg::syntax::source_location{0}} == s.pop());
+    CHECK(std::nullopt == s.pop());
+    CHECK(s.has_failed);
+    CHECK(s.next_location == lpg::syntax::source_location{7});
+}
+
 TEST_CASE("scan_new_line")
 {
     auto s = lpg::syntax::scanner("\n\"Hello\"");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(1, 0) == t.location);
+    CHECK(lpg::syntax::source_location(1) == t.location);
     lpg::syntax::string_literal const string = std::get<lpg::syntax::string_literal>(t.content);
     CHECK(string.inner_content == "Hello");
     CHECK(!s.has_failed);
@@ -57,14 +86,14 @@ TEST_CASE("scan_parentheses")
 {
     auto s = lpg::syntax::scanner("()");
     lpg::syntax::token const first_paren = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == first_paren.location);
+    CHECK(lpg::syntax::source_location(0) == first_paren.location);
 
     CHECK(s.peek());
     lpg::syntax::special_character const character = std::get<lpg::syntax::special_character>(first_paren.content);
     CHECK(character == lpg::syntax::special_character::left_parenthesis);
 
     lpg::syntax::token const second_paren = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 1) == second_paren.location);
+    CHECK(lpg::syntax::source_location(1) == second_paren.location);
 
     CHECK(!s.peek());
     lpg::syntax::special_character const character1 = std::get<lpg::syntax::special_character>(second_paren.content);
@@ -76,7 +105,7 @@ TEST_CASE("scan_identifier")
 {
     auto s = lpg::syntax::scanner("test");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     CHECK(!s.peek());
     lpg::syntax::identifier_token id = std::get<lpg::syntax::identifier_token>(t.content);
     CHECK(id.content == "test");
@@ -87,7 +116,7 @@ TEST_CASE("scan_true")
 {
     auto s = lpg::syntax::scanner("true");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     CHECK(!s.peek());
     lpg::syntax::keyword const keyword = std::get<lpg::syntax::keyword>(t.content);
     CHECK(keyword == lpg::syntax::keyword::true_);
@@ -98,18 +127,54 @@ TEST_CASE("scan_false")
 {
     auto s = lpg::syntax::scanner("false");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     CHECK(!s.peek());
     lpg::syntax::keyword const keyword = std::get<lpg::syntax::keyword>(t.content);
     CHECK(keyword == lpg::syntax::keyword::false_);
     CHECK(!s.has_failed);
 }
 
+TEST_CASE("scan_let")
+{
+    auto s = lpg::syntax::scanner("let");
+    lpg::syntax::token const t = s.pop().value();
+    CHECK(lpg::syntax::source_location(0) == t.location);
+    CHECK(!s.peek());
+    lpg::syntax::keyword const keyword = std::get<lpg::syntax::keyword>(t.content);
+    CHECK(keyword == lpg::syntax::keyword::let_);
+    CHECK(!s.has_failed);
+}
+
+TEST_CASE("scan_keyword_prefixes_and_extensions")
+{
+    for (std::string_view const source : {"l", "le", "lets", "tru", "truex", "fals", "falsee", "t", "f", "x"})
+    {
+        auto s = lpg::syntax::scanner(source);
+        lpg::syntax::token const t = s.pop().value();
+        CHECK(std::get<lpg::syntax::identifier_token>(t.content).content == source);
+        CHECK(!s.peek());
+    }
+}
+
+TEST_CASE("character_classes")
+{
+    CHECK(lpg::syntax::is_whitespace(' '));
+    CHECK(lpg::syntax::is_whitespace('\n'));
+    CHECK(!lpg::syntax::is_whitespace('\t'));
+    CHECK(lpg::syntax::is_identifier_letter('a'));
+    CHECK(lpg::syntax::is_identifier_letter('z'));
+    CHECK(!lpg::syntax::is_identifier_letter('A'));
+    CHECK(!lpg::syntax::is_identifier_letter('0'));
+    CHECK(!lpg::syntax::is_identifier_letter('\xe4'));
+    CHECK(lpg::syntax::classify('=') == lpg::syntax::character_class::equals_sign);
+    CHECK(lpg::syntax::classify('+') == lpg::syntax::character_class::invalid);
+}
+
 TEST_CASE("scan_slash")
 {
     auto s = lpg::syntax::scanner("/ 2");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     CHECK(!s.peek());
     lpg::syntax::special_character const slash = std::get<lpg::syntax::special_character>(t.content);
     CHECK(slash == lpg::syntax::special_character::slash);
@@ -120,7 +185,7 @@ TEST_CASE("scan_equals")
 {
     auto s = lpg::syntax::scanner("== 2");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     CHECK(!s.peek());
     lpg::syntax::special_character const equals = std::get<lpg::syntax::special_character>(t.content);
     CHECK(equals == lpg::syntax::special_character::equals);
@@ -131,7 +196,7 @@ TEST_CASE("scan_comma")
 {
     auto s = lpg::syntax::scanner(", 1");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     CHECK(!s.peek());
     lpg::syntax::special_character const comma = std::get<lpg::syntax::special_character>(t.content);
     CHECK(comma == lpg::syntax::special_character::comma);
@@ -142,7 +207,7 @@ TEST_CASE("scan_slash_end_of_file")
 {
     auto s = lpg::syntax::scanner("/");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     CHECK(!s.peek());
     lpg::syntax::special_character const slash = std::get<lpg::syntax::special_character>(t.content);
     CHECK(slash == lpg::syntax::special_character::slash);
@@ -153,7 +218,7 @@ TEST_CASE("scan_comment_end_of_file")
 {
     auto s = lpg::syntax::scanner("//Just a comment");
     lpg::syntax::token const t = s.pop().value();
-    CHECK(lpg::syntax::source_location(0, 0) == t.location);
+    CHECK(lpg::syntax::source_location(0) == t.location);
     CHECK(!s.peek());
 
     lpg::syntax::comment comment = std::get<lpg::syntax::comment>(t.content);
@@ -164,18 +229,19 @@ TEST_CASE("scan_comment_end_of_file")
 TEST_CASE("scan_comment_end_of_line")
 {
     auto s = lpg::syntax::scanner("//Just a comment\n");
-    std::optional<lpg::syntax::non_comment> const t = peek_next_non_comment(s);
+    lpg::syntax::token const t = s.pop().value();
+    CHECK(std::holds_alternative<lpg::syntax::comment>(t.content));
     CHECK(!s.peek());
-    CHECK(!t.has_value());
     CHECK(!s.has_failed);
 }
 
 TEST_CASE("scan_comment")
 {
     auto s = lpg::syntax::scanner("//Just a comment\ntest");
-    lpg::syntax::non_comment const t = peek_next_non_comment(s).value();
-    CHECK(lpg::syntax::source_location(0, 16) == t.location);
-    CHECK(s.peek());
+    CHECK(std::holds_alternative<lpg::syntax::comment>(s.pop().value().content));
+    lpg::syntax::token const t = s.pop().value();
+    CHECK(lpg::syntax::source_location(17) == t.location);
+    CHECK(!s.peek());
 
     lpg::syntax::identifier_token id = std::get<lpg::syntax::identifier_token>(t.content);
     CHECK(id.content == "test");
@@ -192,7 +258,7 @@ TEST_CASE("print_special_character")
 TEST_CASE("print_identifier_token")
 {
     std::ostringstream s;
-    s << lpg::syntax::identifier_token{"name"};
+    s << lpg::syntax::identifier_token{"name", lpg::syntax::symbol_id{1}};
     CHECK(s.str() == "name");
 }
 
@@ -213,23 +279,22 @@ TEST_CASE("print_comment")
 TEST_CASE("ignore_spaces")
 {
     auto s = lpg::syntax::scanner("let a");
-    lpg::syntax::non_comment const let_token = pop_next_non_comment(s).value();
+    lpg::syntax::token const let_token = s.pop().value();
     CHECK(s.peek());
-    CHECK(let_token ==
-          lpg::syntax::non_comment{lpg::syntax::identifier_token{"let"}, lpg::syntax::source_location{0, 0}});
+    CHECK(let_token == lpg::syntax::token{lpg::syntax::keyword::let_, lpg::syntax::source_location{0}});
 
-    lpg::syntax::non_comment const id_token = pop_next_non_comment(s).value();
+    lpg::syntax::token const id_token = s.pop().value();
     CHECK(!s.peek());
-    CHECK(id_token == lpg::syntax::non_comment{lpg::syntax::identifier_token{"a"}, lpg::syntax::source_location{0, 4}});
+    CHECK(id_token == lpg::syntax::token{lpg::syntax::identifier_token{"a", lpg::syntax::symbol_id{1}},
+                                         lpg::syntax::source_location{4}});
     CHECK(!s.has_failed);
 }
 
 TEST_CASE("scan_assign")
 {
     auto s = lpg::syntax::scanner("=");
-    lpg::syntax::non_comment const let_token = pop_next_non_comment(s).value();
+    lpg::syntax::token const let_token = s.pop().value();
     CHECK(!s.peek());
-    CHECK(let_token ==
-          lpg::syntax::non_comment{lpg::syntax::special_character::assign, lpg::syntax::source_location{0, 0}});
+    CHECK(let_token == lpg::syntax::token{lpg::syntax::special_character::assign, lpg::syntax::source_location{0}});
     CHECK(!s.has_failed);
 }
@@ -18,6 +18,28 @@ namespace
                 got_errors.emplace_back(std::move(error));
             });
         CHECK(expected_errors == got_errors);
+
+        // the flat tree is checked by a separate path that has to agree
+        std::vector<lpg::semantics::semantic_error> flat_errors;
+        lpg::semantics::sequence const checked_flat = lpg::semantics::check_types(
+            lpg::syntax::flatten(parsed), [&flat_errors](lpg::semantics::semantic_error error) {
+                flat_errors.emplace_back(std::move(error));
+            });
+        CHECK(expected_errors == flat_errors);
+        CHECK(checked == checked_flat);
+
+        lpg::count_errors counter;
+        (void)lpg::semantics::check_types(parsed, counter);
+        CHECK(expected_errors.size() == counter.count);
+
+        lpg::diagnostics collected;
+        (void)lpg::semantics::check_types(parsed, collected);
+        REQUIRE(expected_errors.size() == collected.entries.size());
+        for (size_t i = 0; i < expected_errors.size(); ++i)
+        {
+            CHECK(expected_errors[i].message == collected.format(collected.entries[i]));
+            CHECK(expected_errors[i].location == collected.entries[i].where);
+        }
     }
 } // namespace
 
@@ -25,16 +47,16 @@ TEST_CASE("unknown_function")
 {
     expect_semantic_errors(
         R"aaa(hello("ABC"))aaa",
-        {lpg::semantics::semantic_error{"Unknown identifier", lpg::syntax::source_location{0, 0}},
-         lpg::semantics::semantic_error{"This value is not callable", lpg::syntax::source_location{0, 0}}});
+        {lpg::semantics::semantic_error{"Unknown identifier", lpg::syntax::source_location{0}},
+         lpg::semantics::semantic_error{"This value is not callable", lpg::syntax::source_location{0}}});
 }
 
 TEST_CASE("unknown_argument")
 {
     expect_semantic_errors(
         R"aaa(print(uuu))aaa",
-        {lpg::semantics::semantic_error{"Unknown identifier", lpg::syntax::source_location{0, 6}},
-         lpg::semantics::semantic_error{"Argument type mismatch", lpg::syntax::source_location{0, 6}}});
+        {lpg::semantics::semantic_error{"Unknown identifier", lpg::syntax::source_location{6}},
+         lpg::semantics::semantic_error{"Argument type mismatch", lpg::syntax::source_location{6}}});
 }
 
 TEST_CASE("variable_redeclaration")
@@ -42,14 +64,14 @@ TEST_CASE("variable_redeclaration")
     expect_semantic_errors(R"(let a = "Hello world"
 let a = "Hello world")",
                            {lpg::semantics::semantic_error{
-                               "Local variable with this name already exists", lpg::syntax::source_location{1, 4}}});
+                               "Local variable with this name already exists", lpg::syntax::source_location{26}}});
 }
 
 TEST_CASE("argument_type_mismatch")
 {
     expect_semantic_errors(
         R"aaa(print(print))aaa",
-        {lpg::semantics::semantic_error{"Argument type mismatch", lpg::syntax::source_location{0, 6}}});
+        {lpg::semantics::semantic_error{"Argument type mismatch", lpg::syntax::source_location{6}}});
 }
 
 TEST_CASE("not_comparable")
@@ -59,7 +81,7 @@ TEST_CASE("not_comparable")
 let b = true
 let c = b == "string"
 )aaa",
-        {lpg::semantics::semantic_error{"These types are not comparable", lpg::syntax::source_location{2, 8}}});
+        {lpg::semantics::semantic_error{"These types are not comparable", lpg::syntax::source_location{22}}});
 }
 
 TEST_CASE("not_callable")
@@ -68,5 +90,55 @@ TEST_CASE("not_callable")
         R"aaa(let a = "hello"
 a("")
 )aaa",
-        {lpg::semantics::semantic_error{"This value is not callable", lpg::syntax::source_location{1, 0}}});
+        {lpg::semantics::semantic_error{"This value is not callable", lpg::syntax::source_location{16}}});
+}
+
+TEST_CASE("block_scope_ends")
+{
+    expect_semantic_errors(
+        R"aaa({ let a = "hello" }
+print(a)
+)aaa",
+        {lpg::semantics::semantic_error{"Unknown identifier", lpg::syntax::source_location{26}},
+         lpg::semantics::semantic_error{"Argument type mismatch", lpg::syntax::source_location{26}}});
+}
+
+TEST_CASE("blocks_may_reuse_names")
+{
+    expect_semantic_errors(R"aaa(let b = { let a = "hello"
+a }
+{ let a = "world"
+print(a) }
+let a = b
+print(a)
+)aaa",
+                           {});
+}
+
+TEST_CASE("block_may_not_shadow")
+{
+    expect_semantic_errors(
+        R"aaa(let a = "hello"
+{ let a = "world" }
+print(a)
+)aaa",
+        {lpg::semantics::semantic_error{"Local variable with this name already exists",
+                                        lpg::syntax::source_location{22}}});
+}
+
+TEST_CASE("many_bindings")
+{
+    std::string source;
+    for (size_t i = 0; i < 50'000; ++i)
+    {
+        // identifiers consist of letters only
+        std::string name;
+        for (size_t rest = i; rest > 0; rest /= 26)
+        {
+            name += static_cast<char>('a' + (rest % 26));
+        }
+        name += 'z';
+        source += "{ let " + name + " = \"\" print(" + name + ") }\nlet " + name + " = \"\"\n";
+    }
+    expect_semantic_errors(source, {});
 }